@@ -0,0 +1,199 @@
+-- Upgrades a database created by the initial postgresql/schemas/pg_birthday.sql
+-- to the current one, a new database gets it from postgresql/schemas at once.
+-- Run once with the service stopped, before deploying the one which reads the
+-- new tables.
+
+BEGIN;
+
+-- Local days of the users are the days of the service notification_timezone,
+-- the initial schema had no timezones of users. Change it if the service
+-- runs with another one.
+SET LOCAL timezone = 'Europe/Moscow';
+
+-- Users
+
+ALTER TABLE birthday.users
+    ADD COLUMN timezone TEXT NULL,
+    ADD COLUMN notification_time TIME NULL,
+    -- the bucket of the default settings, the trigger below keeps it since
+    ADD COLUMN notification_bucket TEXT NOT NULL DEFAULT '|',
+    ADD COLUMN updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW();
+
+ALTER TABLE birthday.users
+    ALTER COLUMN notification_bucket DROP DEFAULT;
+
+CREATE INDEX users_updated_at_idx ON birthday.users(updated_at);
+CREATE INDEX users_notification_bucket_idx
+    ON birthday.users(notification_bucket, id);
+
+-- Functions and triggers
+
+CREATE FUNCTION birthday.first_occurrence_since(m INTEGER, d INTEGER,
+                                                since DATE)
+RETURNS DATE AS $$
+    SELECT CASE
+        WHEN this_year.occurrence >= since THEN this_year.occurrence
+        ELSE make_date(this_year.year + 1, m, 1) + (d - 1)
+    END
+    FROM (
+        SELECT
+            extract(YEAR FROM since)::INTEGER AS year,
+            make_date(extract(YEAR FROM since)::INTEGER, m, 1) + (d - 1)
+                AS occurrence
+    ) AS this_year
+$$ LANGUAGE SQL IMMUTABLE;
+
+CREATE FUNCTION birthday.set_updated_at() RETURNS TRIGGER AS $$
+BEGIN
+    NEW.updated_at = NOW();
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE FUNCTION birthday.set_notification_bucket() RETURNS TRIGGER AS $$
+BEGIN
+    NEW.notification_bucket = coalesce(NEW.timezone, '') || '|' ||
+        coalesce(to_char(NEW.notification_time, 'HH24:MI'), '');
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER users_set_notification_bucket
+    BEFORE INSERT OR UPDATE ON birthday.users
+    FOR EACH ROW EXECUTE FUNCTION birthday.set_notification_bucket();
+
+CREATE TRIGGER users_set_updated_at
+    BEFORE UPDATE ON birthday.users
+    FOR EACH ROW EXECUTE FUNCTION birthday.set_updated_at();
+
+-- Notifications ledger, filled from birthdays.last_notification_time
+
+CREATE TABLE birthday.notifications_sent(
+    birthday_id INTEGER NOT NULL
+                REFERENCES birthday.birthdays(id) ON DELETE CASCADE,
+    year        INTEGER NOT NULL,
+    notified_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+
+    PRIMARY KEY(birthday_id, year)
+);
+
+CREATE INDEX notifications_sent_notified_at_idx
+    ON birthday.notifications_sent(notified_at);
+
+-- The initial notificator skipped an occurrence if the last notification was
+-- sent after the occurrence day had begun, so the notified occurrence is the
+-- last one on or before the day of the last notification
+INSERT INTO birthday.notifications_sent(
+    birthday_id,
+    year,
+    notified_at
+)
+SELECT
+    birthdays.id,
+    CASE
+        WHEN make_date(notified.year, birthdays.m, 1) + (birthdays.d - 1)
+             <= notified.day
+        THEN notified.year
+        ELSE notified.year - 1
+    END,
+    birthdays.last_notification_time
+FROM birthday.birthdays
+CROSS JOIN LATERAL (
+    SELECT
+        birthdays.last_notification_time::DATE AS day,
+        extract(YEAR FROM birthdays.last_notification_time)::INTEGER AS year
+) AS notified
+WHERE birthdays.last_notification_time IS NOT NULL;
+
+-- Birthdays
+
+-- As the bot sets it for new birthdays: from the forgotten birthday search
+-- distance before today. Occurrences already in the notifications ledger are
+-- skipped.
+ALTER TABLE birthday.birthdays
+    ADD COLUMN next_occurrence DATE NULL,
+    ADD COLUMN updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW();
+
+UPDATE birthday.birthdays
+SET next_occurrence = GREATEST(
+    birthday.first_occurrence_since(
+        birthdays.m,
+        birthdays.d,
+        CURRENT_DATE - 3
+    ),
+    birthday.first_occurrence_since(
+        birthdays.m,
+        birthdays.d,
+        make_date(notified.year + 1, 1, 1)
+    )
+)
+FROM (
+    SELECT
+        birthdays.id,
+        (
+            SELECT max(notifications_sent.year)
+            FROM birthday.notifications_sent
+            WHERE notifications_sent.birthday_id = birthdays.id
+        ) AS year
+    FROM birthday.birthdays
+) AS notified
+WHERE notified.id = birthdays.id;
+
+ALTER TABLE birthday.birthdays
+    ALTER COLUMN next_occurrence SET NOT NULL,
+    DROP COLUMN last_notification_time;
+
+-- birthdays_user_id_next_occurrence_idx serves the lookups by user_id
+DROP INDEX birthday.birthdays_user_id_idx;
+CREATE INDEX birthdays_user_id_next_occurrence_idx
+    ON birthday.birthdays(user_id, next_occurrence, id);
+CREATE INDEX birthdays_next_occurrence_idx
+    ON birthday.birthdays(next_occurrence, id);
+CREATE INDEX birthdays_updated_at_idx ON birthday.birthdays(updated_at);
+
+CREATE TRIGGER birthdays_set_updated_at
+    BEFORE UPDATE ON birthday.birthdays
+    FOR EACH ROW EXECUTE FUNCTION birthday.set_updated_at();
+
+CREATE TABLE birthday.deleted_birthdays(
+    id         INTEGER PRIMARY KEY,
+    user_id    INTEGER NOT NULL,
+    deleted_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+CREATE INDEX deleted_birthdays_deleted_at_idx
+    ON birthday.deleted_birthdays(deleted_at);
+
+CREATE FUNCTION birthday.keep_deleted_birthday() RETURNS TRIGGER AS $$
+BEGIN
+    INSERT INTO birthday.deleted_birthdays(id, user_id)
+    VALUES (OLD.id, OLD.user_id)
+    ON CONFLICT (id) DO UPDATE SET deleted_at = NOW();
+    DELETE FROM birthday.deleted_birthdays
+    WHERE deleted_at < NOW() - INTERVAL '1 day';
+    RETURN OLD;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER birthdays_keep_deleted
+    AFTER DELETE ON birthday.birthdays
+    FOR EACH ROW EXECUTE FUNCTION birthday.keep_deleted_birthday();
+
+-- Notifications outbox
+
+CREATE TABLE birthday.notification_outbox(
+    id              BIGSERIAL PRIMARY KEY,
+    user_id         INTEGER NOT NULL
+                    REFERENCES birthday.users(id) ON DELETE CASCADE,
+    local_day       DATE NOT NULL,
+    text            TEXT NOT NULL,
+    attempts        INTEGER NOT NULL DEFAULT 0,
+    next_attempt_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+
+    UNIQUE(user_id, local_day)
+);
+
+CREATE INDEX notification_outbox_next_attempt_at_idx
+    ON birthday.notification_outbox(next_attempt_at);
+
+COMMIT;
@@ -3,12 +3,23 @@ DROP SCHEMA IF EXISTS birthday CASCADE;
 CREATE SCHEMA birthday;
 
 CREATE TABLE birthday.users(
-    id      SERIAL PRIMARY KEY,
-    chat_id BIGINT NOT NULL,
+    id                SERIAL PRIMARY KEY,
+    chat_id           BIGINT NOT NULL,
+    -- NULL means the default of the service
+    timezone          TEXT NULL,
+    notification_time TIME NULL,
+    -- users with the same settings are notified together, set from the
+    -- settings by a trigger
+    notification_bucket TEXT NOT NULL,
+    updated_at        TIMESTAMPTZ NOT NULL DEFAULT NOW(),
 
     UNIQUE(chat_id)
 );
 
+CREATE INDEX users_updated_at_idx ON birthday.users(updated_at);
+CREATE INDEX users_notification_bucket_idx
+    ON birthday.users(notification_bucket, id);
+
 CREATE TABLE birthday.birthdays(
     id                     SERIAL PRIMARY KEY,
     person                 TEXT NOT NULL,
@@ -16,11 +27,122 @@ CREATE TABLE birthday.birthdays(
     m                      INTEGER NOT NULL,
     d                      INTEGER NOT NULL,
     notification_enabled   BOOLEAN NOT NULL,
-    last_notification_time TIMESTAMPTZ,
-    user_id                INTEGER NOT NULL REFERENCES birthday.users(id)
+    -- local day of the user the nearest occurrence not notified yet is
+    -- celebrated on, advanced a year once it is notified or passed
+    next_occurrence        DATE NOT NULL,
+    user_id                INTEGER NOT NULL REFERENCES birthday.users(id),
+    updated_at             TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+-- also serves the next birthdays of a user in order
+CREATE INDEX birthdays_user_id_next_occurrence_idx
+    ON birthday.birthdays(user_id, next_occurrence, id);
+CREATE INDEX birthdays_next_occurrence_idx
+    ON birthday.birthdays(next_occurrence, id);
+CREATE INDEX birthdays_updated_at_idx ON birthday.birthdays(updated_at);
+
+-- First occurrence of the birthday on or after the day, Feb 29 is celebrated
+-- on Mar 1 in non-leap years
+CREATE FUNCTION birthday.first_occurrence_since(m INTEGER, d INTEGER,
+                                                since DATE)
+RETURNS DATE AS $$
+    SELECT CASE
+        WHEN this_year.occurrence >= since THEN this_year.occurrence
+        ELSE make_date(this_year.year + 1, m, 1) + (d - 1)
+    END
+    FROM (
+        SELECT
+            extract(YEAR FROM since)::INTEGER AS year,
+            make_date(extract(YEAR FROM since)::INTEGER, m, 1) + (d - 1)
+                AS occurrence
+    ) AS this_year
+$$ LANGUAGE SQL IMMUTABLE;
+
+-- Deleted birthdays are kept for a while for incremental updates of caches
+CREATE TABLE birthday.deleted_birthdays(
+    id         INTEGER PRIMARY KEY,
+    user_id    INTEGER NOT NULL,
+    deleted_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+CREATE INDEX deleted_birthdays_deleted_at_idx
+    ON birthday.deleted_birthdays(deleted_at);
+
+CREATE FUNCTION birthday.set_updated_at() RETURNS TRIGGER AS $$
+BEGIN
+    NEW.updated_at = NOW();
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+-- The format is the one of NotificationBucket::GetKey
+CREATE FUNCTION birthday.set_notification_bucket() RETURNS TRIGGER AS $$
+BEGIN
+    NEW.notification_bucket = coalesce(NEW.timezone, '') || '|' ||
+        coalesce(to_char(NEW.notification_time, 'HH24:MI'), '');
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER users_set_notification_bucket
+    BEFORE INSERT OR UPDATE ON birthday.users
+    FOR EACH ROW EXECUTE FUNCTION birthday.set_notification_bucket();
+
+CREATE TRIGGER users_set_updated_at
+    BEFORE UPDATE ON birthday.users
+    FOR EACH ROW EXECUTE FUNCTION birthday.set_updated_at();
+
+CREATE TRIGGER birthdays_set_updated_at
+    BEFORE UPDATE ON birthday.birthdays
+    FOR EACH ROW EXECUTE FUNCTION birthday.set_updated_at();
+
+CREATE FUNCTION birthday.keep_deleted_birthday() RETURNS TRIGGER AS $$
+BEGIN
+    INSERT INTO birthday.deleted_birthdays(id, user_id)
+    VALUES (OLD.id, OLD.user_id)
+    ON CONFLICT (id) DO UPDATE SET deleted_at = NOW();
+    DELETE FROM birthday.deleted_birthdays
+    WHERE deleted_at < NOW() - INTERVAL '1 day';
+    RETURN OLD;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER birthdays_keep_deleted
+    AFTER DELETE ON birthday.birthdays
+    FOR EACH ROW EXECUTE FUNCTION birthday.keep_deleted_birthday();
+
+-- Occurrences of birthdays users were notified about, the year is the one
+-- the birthday was celebrated in. A notification is planned only if the
+-- occurrence is missing here, so replays and concurrent planners are harmless.
+CREATE TABLE birthday.notifications_sent(
+    birthday_id INTEGER NOT NULL
+                REFERENCES birthday.birthdays(id) ON DELETE CASCADE,
+    year        INTEGER NOT NULL,
+    notified_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+
+    PRIMARY KEY(birthday_id, year)
+);
+
+CREATE INDEX notifications_sent_notified_at_idx
+    ON birthday.notifications_sent(notified_at);
+
+-- Planned notifications waiting for delivery, their birthdays are already in
+-- the notifications ledger
+CREATE TABLE birthday.notification_outbox(
+    id              BIGSERIAL PRIMARY KEY,
+    user_id         INTEGER NOT NULL
+                    REFERENCES birthday.users(id) ON DELETE CASCADE,
+    local_day       DATE NOT NULL,
+    text            TEXT NOT NULL,
+    attempts        INTEGER NOT NULL DEFAULT 0,
+    next_attempt_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+
+    -- a user gets at most one notification a day
+    UNIQUE(user_id, local_day)
 );
 
-CREATE INDEX birthdays_user_id_idx ON birthday.birthdays(user_id);
+CREATE INDEX notification_outbox_next_attempt_at_idx
+    ON birthday.notification_outbox(next_attempt_at);
 
 DROP SCHEMA IF EXISTS service CASCADE;
 CREATE SCHEMA service;
@@ -1,7 +1,9 @@
 #include "birthday_notificator.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <exception>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -10,27 +12,44 @@
 
 #include <userver/components/component_config.hpp>
 #include <userver/components/component_context.hpp>
+#include <userver/components/statistics_storage.hpp>
+#include <userver/dist_lock/dist_lock_settings.hpp>
 #include <userver/engine/async.hpp>
+#include <userver/engine/deadline.hpp>
 #include <userver/engine/sleep.hpp>
 #include <userver/engine/task/cancel.hpp>
 #include <userver/formats/json/value.hpp>
 #include <userver/logging/log.hpp>
 #include <userver/storages/postgres/cluster.hpp>
 #include <userver/storages/postgres/component.hpp>
+#include <userver/storages/postgres/dist_lock_strategy.hpp>
 #include <userver/storages/secdist/component.hpp>
 #include <userver/testsuite/testpoint.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
 #include <userver/tracing/span.hpp>
 #include <userver/utils/datetime.hpp>
+#include <userver/utils/statistics/writer.hpp>
+#include <userver/utils/uuid4.hpp>
 #include <userver/yaml_config/merge_schemas.hpp>
 
 #include <db/birthdays.hpp>
+#include <db/distlocks.hpp>
+#include <db/notification_outbox.hpp>
 #include <db/users.hpp>
+#include <utils/statistics.hpp>
 
 namespace telegram_bot::components {
 
 namespace {
 
-const std::chrono::days kForgottenBirthdaySearchDistance(3);
+// Locks of dead instances are kept for a while for debugging
+const std::chrono::hours kExpiredInstanceLockTtl(1);
+
+const models::UserShard kAllUsers{};
+
+// testsuite task to run an iteration reading birthdays from birthdays-cache
+const std::string kCalendarCacheTaskName =
+    "birthday-notificator-calendar-cache";
 
 template <typename T>
 userver::formats::json::ValueBuilder SerializeArray(const T& array) {
@@ -46,17 +65,67 @@ userver::formats::json::ValueBuilder SerializeArray(const T& array) {
 
 const std::string kComponentConfigSchema = R"(
 type: object
-description: ClickHouse client component
+description: Plans notifications of users about birthdays of the day
 additionalProperties: false
 properties:
     notification_time_of_day:
-        description: Hour and minute after which notification can be sent
+        description: |
+            Hour and minute after which notification can be sent, default
+            for users which have not set their own
         type: string
     notification_timezone:
-        description: Timezone name for time of day calculation
+        description: |
+            Timezone name for time of day calculation, default for users which
+            have not set their own
+        type: string
+    fetch_chunk_size:
+        description: |
+            Number of birthdays fetched at once, bounds memory used by an
+            iteration
+        type: integer
+        minimum: 1
+        defaultDescription: 1000
+    shards:
+        description: |
+            Number of user shards with locks of their own, so that several
+            instances notify users at once. 1 disables sharding
+        type: integer
+        minimum: 1
+        defaultDescription: 1
+    max_sleep_duration:
+        description: |
+            Maximum sleep between iterations, birthdays changed by other
+            instances are noticed after it
+        type: string
+        defaultDescription: 1h
+    retry_delay:
+        description: Delay before the next iteration if planning failed
         type: string
+        defaultDescription: 10m
+    use_calendar_cache:
+        description: |
+            Read birthdays from birthdays-cache instead of scanning the
+            database on every iteration
+        type: boolean
+        defaultDescription: false
+    calendar_cache_lag:
+        description: |
+            How long birthdays changes take to reach birthdays-cache, should
+            cover its update interval and correction
+        type: string
+        defaultDescription: 10s
+    shards_rebalance_period:
+        description: How often an instance gives away shards over its share
+        type: string
+        defaultDescription: 10s
 )";
 
+void Account(impl::PhaseTimings& timings,
+             const std::chrono::steady_clock::duration duration) {
+  timings.GetCurrentCounter().Account(
+      std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+}
+
 }  // namespace
 
 const std::string BirthdayNotificator::kName = "birthday-notificator";
@@ -74,7 +143,10 @@ BirthdayNotificator::BirthdayNotificator(
       postgres_(
           context.FindComponent<userver::components::Postgres>("postgres-db")
               .GetCluster()),
-      bot_(context.FindComponent<bot::Component>()) {
+      bot_(context.FindComponent<bot::Component>()),
+      testsuite_tasks_(
+          context.FindComponent<userver::components::TestsuiteSupport>()
+              .GetTestsuiteTasks()) {
   const std::string timezone_name =
       config["notification_timezone"].As<std::string>();
   if (!cctz::load_time_zone(timezone_name, &notification_timezone_)) {
@@ -84,141 +156,591 @@ BirthdayNotificator::BirthdayNotificator(
   notification_time_of_day_ =
       userver::utils::datetime::TimeOfDay<std::chrono::minutes>(
           config["notification_time_of_day"].As<std::string>());
+  fetch_chunk_size_ = config["fetch_chunk_size"].As<std::size_t>(1000);
+  max_sleep_ = config["max_sleep_duration"].As<std::chrono::milliseconds>(
+      std::chrono::hours(1));
+  retry_delay_ = config["retry_delay"].As<std::chrono::milliseconds>(
+      std::chrono::minutes(10));
+
+  if (config["use_calendar_cache"].As<bool>(false)) {
+    birthdays_cache_ = &context.FindComponent<BirthdaysCache>();
+    calendar_cache_lag_ =
+        config["calendar_cache_lag"].As<std::chrono::milliseconds>(
+            std::chrono::seconds(10));
+  }
+  // Tests run iterations over the cache whatever the configured source is
+  if (testsuite_tasks_.IsEnabled()) {
+    const auto& birthdays_cache = context.FindComponent<BirthdaysCache>();
+    testsuite_tasks_.RegisterTask(
+        kCalendarCacheTaskName, [this, &birthdays_cache] {
+          RunTestsuiteIterations(&birthdays_cache);
+        });
+  }
 
-  AutostartDistLock();
+  const auto shards = config["shards"].As<int32_t>(1);
+  changed_users_.resize(shards);
+  birthdays_changed_subscription_ =
+      bot_.GetBirthdaysChangedChannel().AddListener(
+          this, kName, &BirthdayNotificator::OnBirthdaysChanged);
+
+  auto& storage =
+      context.FindComponent<userver::components::StatisticsStorage>()
+          .GetStorage();
+  statistics_holder_ = storage.RegisterWriter(
+      kName, [this](userver::utils::statistics::Writer& writer) {
+        writer["rows-scanned"] = metrics_.rows_scanned;
+        writer["rows-matched"] = metrics_.rows_matched;
+        writer["users-planned"] = metrics_.users_planned;
+        writer["users-postponed"] = metrics_.users_postponed;
+        writer["failed-iterations"] = metrics_.failed_iterations;
+        utils::WritePercentiles(writer["fetch-time-ms"],
+                                metrics_.fetch_timings);
+        utils::WritePercentiles(writer["filter-time-ms"],
+                                metrics_.filter_timings);
+        utils::WritePercentiles(writer["plan-time-ms"], metrics_.plan_timings);
+        utils::WritePercentiles(writer["iteration-time-ms"],
+                                metrics_.iteration_timings);
+      });
+
+  if (shards > 1) {
+    StartShards(config, shards);
+  } else {
+    AutostartDistLock();
+  }
 }
 
-BirthdayNotificator::~BirthdayNotificator() { StopDistLock(); }
+BirthdayNotificator::~BirthdayNotificator() {
+  rebalance_task_.Stop();
+  for (auto& shard_worker : shard_workers_) {
+    if (!shard_worker.stopped_at.has_value()) {
+      shard_worker.worker->Stop();
+    }
+  }
+  if (instance_worker_) {
+    instance_worker_->Stop();
+  }
+  StopDistLock();
+  if (testsuite_tasks_.IsEnabled()) {
+    testsuite_tasks_.UnregisterTask(kCalendarCacheTaskName);
+  }
+  birthdays_changed_subscription_.Unsubscribe();
+}
+
+void BirthdayNotificator::StartShards(
+    const userver::components::ComponentConfig& config, const int32_t shards) {
+  distlock_table_ = config["table"].As<std::string>();
+  const auto lock_name = config["lockname"].As<std::string>();
+  shard_lock_prefix_ = lock_name + "-shard-";
+  instance_lock_prefix_ = lock_name + "-instance-";
+  rebalance_period_ =
+      config["shards_rebalance_period"].As<std::chrono::milliseconds>(
+          std::chrono::seconds(10));
+
+  userver::dist_lock::DistLockSettings settings;
+  settings.lock_ttl = config["lock-ttl"].As<std::chrono::milliseconds>();
+  settings.prolong_interval = settings.lock_ttl / 3;
+  settings.forced_stop_margin =
+      config["pg-timeout"].As<std::chrono::milliseconds>();
+  settings.worker_func_restart_delay =
+      config["restart-delay"].As<std::chrono::milliseconds>(
+          std::chrono::seconds(1));
+
+  const auto make_worker = [this, &settings](
+                               const std::string& key,
+                               userver::dist_lock::WorkerFunc worker_func) {
+    return std::make_unique<userver::dist_lock::DistLockedWorker>(
+        key, std::move(worker_func),
+        std::make_shared<userver::storages::postgres::DistLockStrategy>(
+            postgres_, distlock_table_, key, settings),
+        settings);
+  };
+
+  instance_worker_ = make_worker(
+      instance_lock_prefix_ + userver::utils::generators::GenerateUuid(), [] {
+        // holding the lock is enough to be counted as a live instance
+        while (!userver::engine::current_task::ShouldCancel()) {
+          userver::engine::InterruptibleSleepFor(std::chrono::hours(1));
+        }
+      });
+  instance_worker_->Start();
+
+  for (int32_t index = 0; index < shards; ++index) {
+    const models::UserShard shard{index, shards};
+    shard_workers_.push_back(
+        {make_worker(shard_lock_prefix_ + std::to_string(index),
+                     [this, shard] { RunLoop(shard); }),
+         std::nullopt});
+    shard_workers_.back().worker->Start();
+  }
+
+  rebalance_task_.Start(
+      "birthday-notificator-rebalance",
+      userver::utils::PeriodicTask::Settings{rebalance_period_},
+      [this] { RebalanceShards(); });
+}
+
+void BirthdayNotificator::RebalanceShards() {
+  const auto now = std::chrono::steady_clock::now();
+  // Shards given away are left for other instances for a rebalance period
+  for (auto& shard_worker : shard_workers_) {
+    if (shard_worker.stopped_at.has_value() &&
+        now - *shard_worker.stopped_at >= rebalance_period_) {
+      shard_worker.worker->Start();
+      shard_worker.stopped_at.reset();
+    }
+  }
+
+  const auto instances = std::max<int64_t>(
+      1, db::CountLiveLocks(distlock_table_, instance_lock_prefix_,
+                            *postgres_));
+  const auto shards = static_cast<int64_t>(shard_workers_.size());
+  const auto fair_share = (shards + instances - 1) / instances;
+  auto owned = std::count_if(
+      shard_workers_.begin(), shard_workers_.end(),
+      [](const ShardWorker& shard_worker) {
+        return shard_worker.worker->OwnsLock();
+      });
+  LOG_DEBUG() << "Own " << owned << " of " << shards << " shards, "
+              << instances << " instances alive";
+
+  for (std::size_t index = 0; index < shard_workers_.size(); ++index) {
+    if (owned <= fair_share) {
+      break;
+    }
+    auto& shard_worker = shard_workers_[index];
+    if (shard_worker.worker->OwnsLock()) {
+      LOG_INFO() << "Give away shard " << index;
+      shard_worker.worker->Stop();
+      shard_worker.stopped_at = now;
+      --owned;
+    }
+  }
+
+  db::DeleteExpiredLocks(distlock_table_, instance_lock_prefix_,
+                         kExpiredInstanceLockTtl, *postgres_);
+}
 
 void BirthdayNotificator::DoWorkTestsuite() {
+  RunTestsuiteIterations(birthdays_cache_);
+}
+
+void BirthdayNotificator::RunTestsuiteIterations(
+    const BirthdaysCache* birthdays_cache) {
   try {
-    RunIteration();
+    for (const auto& bucket :
+         FetchNotificationBuckets(kAllUsers, birthdays_cache)) {
+      RunIteration(kAllUsers, bucket, GetSchedule(bucket), birthdays_cache);
+    }
   } catch (const std::exception& exc) {
+    ++metrics_.failed_iterations;
     LOG_ERROR() << exc.what();
   }
 }
 
-void BirthdayNotificator::DoWork() {
+void BirthdayNotificator::DoWork() { RunLoop(kAllUsers); }
+
+void BirthdayNotificator::RunLoop(const models::UserShard& shard) {
+  NotifiedDays notified_days;
+  {
+    // the buckets of the shard are planned from scratch anyway
+    std::lock_guard lock(changes_mutex_);
+    changed_users_[shard.index].clear();
+  }
   while (!userver::engine::current_task::ShouldCancel()) {
-    RunIteration();
-    userver::engine::InterruptibleSleepFor(std::chrono::minutes(10));
+    const auto now = userver::utils::datetime::Now();
+    auto wake_up_time = now + max_sleep_;
+    try {
+      for (const auto& bucket :
+           FetchNotificationBuckets(shard, birthdays_cache_)) {
+        wake_up_time = std::min(
+            wake_up_time, ProcessBucket(shard, bucket, now, notified_days));
+      }
+    } catch (const std::exception& exc) {
+      LOG_ERROR() << "Failed to fetch notification buckets: " << exc;
+      wake_up_time = std::min(wake_up_time, now + retry_delay_);
+    }
+
+    LOG_DEBUG() << "Next notification iteration at "
+                << userver::utils::datetime::Timestring(wake_up_time);
+    const auto changed_users = WaitForChanges(shard, wake_up_time);
+    if (changed_users.empty()) {
+      continue;
+    }
+    LOG_DEBUG() << "Birthdays of " << changed_users.size()
+                << " users changed, look for new notifications";
+    if (birthdays_cache_) {
+      // changes and notification marks reach the cache with its updates
+      userver::engine::InterruptibleSleepFor(calendar_cache_lag_);
+    }
+    // only the buckets of the changed users are planned again
+    try {
+      for (const auto& bucket : FetchNotificationBuckets(changed_users)) {
+        notified_days.erase(bucket.GetKey());
+      }
+    } catch (const std::exception& exc) {
+      LOG_ERROR() << "Failed to fetch notification buckets of users: " << exc;
+      notified_days.clear();
+    }
+  }
+}
+
+models::TimePoint BirthdayNotificator::ProcessBucket(
+    const models::UserShard& shard, const models::NotificationBucket& bucket,
+    const models::TimePoint now, NotifiedDays& notified_days) {
+  const auto bucket_key = bucket.GetKey();
+  try {
+    const auto schedule = GetSchedule(bucket);
+    const auto local_day =
+        cctz::civil_day(cctz::convert(now, schedule.timezone));
+    const auto notification_time = impl::GetNotificationTime(
+        local_day, schedule.time_of_day, schedule.timezone);
+    if (now < notification_time) {
+      return notification_time;
+    }
+
+    const auto notified_it = notified_days.find(bucket_key);
+    if (notified_it == notified_days.end() ||
+        notified_it->second != local_day) {
+      if (!RunIteration(shard, bucket, schedule, birthdays_cache_)) {
+        return now + retry_delay_;
+      }
+      notified_days.insert_or_assign(bucket_key, local_day);
+    }
+    return impl::GetNotificationTime(local_day + 1, schedule.time_of_day,
+                                     schedule.timezone);
+  } catch (const std::exception& exc) {
+    ++metrics_.failed_iterations;
+    LOG_ERROR() << "Failed to notify users of bucket " << bucket_key << ": "
+                << exc;
+    return now + retry_delay_;
+  }
+}
+
+std::vector<models::NotificationBucket>
+BirthdayNotificator::FetchNotificationBuckets(
+    const models::UserShard& shard,
+    const BirthdaysCache* birthdays_cache) const {
+  if (birthdays_cache) {
+    return birthdays_cache->Get()->GetNotificationBuckets(shard);
+  }
+  return db::FetchNotificationBuckets(shard, *postgres_);
+}
+
+std::vector<models::NotificationBucket>
+BirthdayNotificator::FetchNotificationBuckets(
+    const std::vector<models::UserId>& user_ids) const {
+  if (birthdays_cache_) {
+    // users without birthdays have nothing to be notified about
+    return birthdays_cache_->Get()->GetNotificationBuckets(user_ids);
+  }
+  return db::FetchNotificationBuckets(user_ids, *postgres_);
+}
+
+impl::NotificationSchedule BirthdayNotificator::GetSchedule(
+    const models::NotificationBucket& bucket) const {
+  impl::NotificationSchedule schedule{notification_timezone_,
+                                      notification_time_of_day_};
+  if (bucket.timezone.has_value() &&
+      !cctz::load_time_zone(*bucket.timezone, &schedule.timezone)) {
+    throw std::runtime_error("Unknown timezone " + *bucket.timezone);
+  }
+  if (bucket.notification_time_of_day.has_value()) {
+    schedule.time_of_day =
+        userver::utils::datetime::TimeOfDay<std::chrono::minutes>(
+            *bucket.notification_time_of_day);
   }
+  return schedule;
 }
 
-void BirthdayNotificator::RunIteration() {
+std::vector<models::UserId> BirthdayNotificator::WaitForChanges(
+    const models::UserShard& shard, const models::TimePoint until) {
+  std::unique_lock lock(changes_mutex_);
+  auto& changed_users = changed_users_[shard.index];
+  changes_cv_.WaitUntil(lock,
+                        userver::engine::Deadline::FromDuration(
+                            until - userver::utils::datetime::Now()),
+                        [&changed_users] { return !changed_users.empty(); });
+  std::vector<models::UserId> result(changed_users.begin(),
+                                     changed_users.end());
+  changed_users.clear();
+  return result;
+}
+
+void BirthdayNotificator::OnBirthdaysChanged(const models::UserId user_id) {
+  {
+    std::lock_guard lock(changes_mutex_);
+    const auto shard_index =
+        user_id.GetUnderlying() % static_cast<int32_t>(changed_users_.size());
+    changed_users_[shard_index].insert(user_id);
+  }
+  changes_cv_.NotifyAll();
+}
+
+bool BirthdayNotificator::RunIteration(
+    const models::UserShard& shard, const models::NotificationBucket& bucket,
+    const impl::NotificationSchedule& schedule,
+    const BirthdaysCache* birthdays_cache) {
   userver::tracing::Span span(kName);
-  LOG_INFO() << "Start birthday-notificator iteration";
+  LOG_INFO() << "Start birthday-notificator iteration, shard " << shard.index
+             << " of " << shard.count << ", timezone "
+             << bucket.timezone.value_or("default") << ", time "
+             << bucket.notification_time_of_day.value_or("default");
   const auto now = userver::utils::datetime::Now();
   LOG_DEBUG() << "at " << userver::utils::datetime::Timestring(now);
-  const auto local_time = cctz::convert(now, notification_timezone_);
-  const auto local_day = cctz::civil_day(local_time);
-  const auto local_notification_hour =
-      cctz::civil_hour(local_day) + notification_time_of_day_.Hours().count();
-  const auto local_notification_time =
-      cctz::civil_minute(local_notification_hour) +
-      notification_time_of_day_.Minutes().count();
-  // const auto notification_time =
-  //     cctz::convert(local_notification_time, notification_timezone_);
-  // LOG_INFO() << "Notification time: "
-  //            << userver::utils::datetime::Timestring(notification_time);
-
-  // TODO dangerous if notification time is 23:50 or later
-  if (local_time < local_notification_time) {
+  const auto local_day =
+      cctz::civil_day(cctz::convert(now, schedule.timezone));
+  if (now < impl::GetNotificationTime(local_day, schedule.time_of_day,
+                                      schedule.timezone)) {
     LOG_DEBUG() << "Notification time not reached, exit";
-    return;
+    return false;
   }
 
-  const auto rows = db::FetchAllBirthdays(*postgres_);
-  const auto birthdays_to_notify =
-      impl::FindBirthdaysToNotify(rows, notification_timezone_, local_day);
-
-  TESTPOINT("birthday-notificator", [&birthdays_to_notify]() {
-    userver::formats::json::ValueBuilder builder;
-    for (const auto& [user_id, birthdays] : birthdays_to_notify) {
-      userver::formats::json::ValueBuilder user_builder;
-      user_builder["forgotten"] = SerializeArray(birthdays.forgotten);
-      user_builder["celebrate_today"] =
-          SerializeArray(birthdays.celebrate_today);
-      builder[std::to_string(user_id.GetUnderlying())] = user_builder;
+  using Clock = std::chrono::steady_clock;
+  const auto iteration_start = Clock::now();
+  Clock::duration filter_time{};
+  Clock::duration plan_time{};
+  int64_t planned_users = 0;
+  int64_t postponed_users = 0;
+  // Rows are owned birthdays from the cache or a batch streamed from the
+  // database
+  const auto handle_chunk = [&](const auto& rows) {
+    const auto filter_start = Clock::now();
+    auto birthdays_to_notify = impl::FindBirthdaysToNotify(rows, local_day);
+
+    TESTPOINT("birthday-notificator", [&birthdays_to_notify]() {
+      userver::formats::json::ValueBuilder builder;
+      for (const auto& [user_id, birthdays] : birthdays_to_notify) {
+        userver::formats::json::ValueBuilder user_builder;
+        user_builder["forgotten"] = SerializeArray(birthdays.forgotten);
+        user_builder["celebrate_today"] =
+            SerializeArray(birthdays.celebrate_today);
+        builder[std::to_string(user_id.GetUnderlying())] = user_builder;
+      }
+      return builder.ExtractValue();
+    }());
+
+    std::vector<models::PlannedNotification> notifications;
+    notifications.reserve(birthdays_to_notify.size());
+    std::size_t matched_rows = 0;
+    for (auto& [user_id, birthdays] : birthdays_to_notify) {
+      matched_rows += birthdays.occurrences.size();
+      notifications.push_back({user_id, std::move(birthdays.occurrences),
+                               std::move(birthdays.celebrate_today),
+                               std::move(birthdays.forgotten)});
     }
-    return builder.ExtractValue();
-  }());
+    const auto plan_start = Clock::now();
+    filter_time += plan_start - filter_start;
+    // Delivered by notification-sender, so a slow or failed send does not
+    // hold up planning
+    const auto plan_result =
+        db::PlanNotifications(local_day, notifications, *postgres_);
+    plan_time += Clock::now() - plan_start;
+
+    planned_users += plan_result.queued_users;
+    postponed_users += plan_result.postponed_users;
+    metrics_.rows_scanned += rows.size();
+    metrics_.rows_matched += matched_rows;
+    metrics_.users_planned += plan_result.queued_users;
+    metrics_.users_postponed += plan_result.postponed_users;
+  };
+
+  const auto first_day =
+      local_day - models::kForgottenBirthdaySearchDistance.count();
+  if (birthdays_cache) {
+    // One extra day covers Feb 29 birthdays, which are celebrated on Mar 1 in
+    // non-leap years
+    handle_chunk(birthdays_cache->Get()->GetBirthdaysInWindow(
+        first_day - 1, local_day, shard, bucket));
+  } else {
+    // Occurrences which were not notified, e.g. notifications of them were
+    // disabled, move on to come into the window scan again. The calendar
+    // cache reads (m, d) and /next_birthdays orders by the occurrences of
+    // (m, d), so the cache mode skips that update.
+    db::AdvancePassedOccurrences(first_day, shard, bucket, *postgres_);
+    db::StreamBirthdaysInWindow(first_day, local_day, shard, bucket,
+                                fetch_chunk_size_, handle_chunk, *postgres_);
+  }
+  const auto iteration_time = Clock::now() - iteration_start;
+  Account(metrics_.fetch_timings, iteration_time - filter_time - plan_time);
+  Account(metrics_.filter_timings, filter_time);
+  Account(metrics_.plan_timings, plan_time);
+  Account(metrics_.iteration_timings, iteration_time);
+  LOG_INFO() << "Planned notifications of " << planned_users << " users";
+  if (postponed_users > 0) {
+    LOG_WARNING() << "Notifications of " << postponed_users
+                  << " users were being sent, plan them again later";
+    return false;
+  }
+  return true;
+}
 
-  for (const auto& [user_id, birthdays] : birthdays_to_notify) {
-    std::vector<std::string> lines;
-    if (!birthdays.celebrate_today.empty()) {
-      lines.push_back(fmt::format("Today is birthday of {}",
-                                  fmt::join(birthdays.celebrate_today, ", ")));
-    }
-    if (!birthdays.forgotten.empty()) {
-      lines.push_back(fmt::format("You forgot about birthdays: \n{}",
-                                  fmt::join(birthdays.forgotten, "\n")));
-    }
+namespace impl {
 
-    if (lines.empty()) {
-      continue;
-    }
+models::TimePoint GetNotificationTime(
+    const cctz::civil_day& local_day,
+    const userver::utils::datetime::TimeOfDay<std::chrono::minutes>&
+        time_of_day,
+    const cctz::time_zone& notification_timezone) {
+  const auto local_time = cctz::civil_minute(local_day) +
+                          time_of_day.Hours().count() * 60 +
+                          time_of_day.Minutes().count();
+  return cctz::convert(local_time, notification_timezone);
+}
 
-    const auto chat_id = db::GetChatId(user_id, *postgres_);
-    bot_.SendMessage(chat_id, fmt::format("{}", fmt::join(lines, "\n")));
+namespace {
 
-    for (const auto id : birthdays.ids) {
-      db::UpdateBirthdayLastNotificationTime(now, id, *postgres_);
-    }
+template <typename Rows>
+BirthdayColumns MakeColumns(const Rows& rows) {
+  BirthdayColumns columns;
+  columns.day.reserve(rows.size());
+  columns.last_notified_year.reserve(rows.size());
+  for (const auto& row : rows) {
+    columns.day.push_back(
+        row.notification_enabled
+            ? static_cast<uint16_t>(models::GetDayOfLeapYear(row.m, row.d))
+            : kDisabledDay);
+    columns.last_notified_year.push_back(
+        row.last_notified_year.has_value()
+            ? static_cast<int32_t>(row.last_notified_year->GetUnderlying())
+            : kNeverNotified);
   }
+  return columns;
 }
 
-namespace impl {
+}  // namespace
 
-std::unordered_map<models::UserId, BirthdaysToNotify> FindBirthdaysToNotify(
-    const std::vector<models::Birthday>& rows,
-    const cctz::time_zone& notification_timezone,
+NotificationDayTable MakeNotificationDayTable(
     const cctz::civil_day& local_day) {
   const auto farthest_forgotten_day =
-      local_day - kForgottenBirthdaySearchDistance.count();
-
-  std::unordered_map<models::UserId, BirthdaysToNotify> result;
-  for (const auto& row : rows) {
-    if (!row.notification_enabled) {
-      LOG_DEBUG() << "Skip birthday with disabled notification";
-      continue;
-    }
+      local_day - models::kForgottenBirthdaySearchDistance.count();
+
+  NotificationDayTable table;
+  table.year.fill(kOutsideWindow);
+  table.is_today.fill(0);
+  // Any leap year enumerates all (m, d) including Feb 29
+  for (cctz::civil_day day(2000, 1, 1); day.year() == 2000; ++day) {
+    const models::BirthdayMonth m{day.month()};
+    const models::BirthdayDay d{day.day()};
     const auto birthday_year =
         cctz::civil_year(local_day) -
-        (std::tuple(row.m, row.d) <=
+        (std::tuple(m, d) <=
                  std::tuple(models::BirthdayMonth{local_day.month()},
                             models::BirthdayDay{local_day.day()})
              ? 0
              : 1);
-    const auto birthday = cctz::civil_day(cctz::civil_month(birthday_year) +
-                                          row.m.GetUnderlying() - 1) +
-                          row.d.GetUnderlying() - 1;
+    // Feb 29 turns into Mar 1 in non-leap years
+    const auto birthday =
+        cctz::civil_day(cctz::civil_month(birthday_year) + day.month() - 1) +
+        day.day() - 1;
     if (birthday < farthest_forgotten_day) {
-      LOG_DEBUG() << "Skip too old birthday";
       continue;
     }
 
-    // TODO May cause duplicate notification on timezone change, deal with it
-    // later
-    if (row.last_notification_time.has_value() &&
-        *row.last_notification_time >
-            cctz::convert(birthday, notification_timezone)) {
-      LOG_DEBUG() << "Skip already notified birthday";
-      continue;
+    const auto index = models::GetDayOfLeapYear(m, d);
+    table.year[index] = static_cast<int32_t>(birthday_year.year());
+    table.is_today[index] = birthday == local_day;
+  }
+
+  // the window is a single run of days, Feb 29 is between Feb 28 and Mar 1
+  for (int index = 0; index < models::kDaysInLeapYear; ++index) {
+    const auto previous =
+        (index + models::kDaysInLeapYear - 1) % models::kDaysInLeapYear;
+    if (table.year[index] != kOutsideWindow) {
+      ++table.window_size;
+      if (table.year[previous] == kOutsideWindow) {
+        table.window_first = static_cast<uint16_t>(index);
+        table.window_first_year = table.year[index];
+      }
     }
+  }
+  return table;
+}
+
+void SelectBirthdaysToNotify(const BirthdayColumns& columns,
+                             const NotificationDayTable& table,
+                             std::vector<uint8_t>& selected) {
+  const auto size = columns.day.size();
+  selected.resize(size);
+  const auto* day = columns.day.data();
+  const auto* last_notified_year = columns.last_notified_year.data();
+  auto* result = selected.data();
+  const int32_t first = table.window_first;
+  const uint32_t window_size = table.window_size;
+  // offset of the first day of the next year
+  const int32_t next_year_offset = models::kDaysInLeapYear - first;
+  const int32_t first_year = table.window_first_year;
+  // Branchless arithmetic on the columns without lookups in the table, so
+  // that the loop is vectorized
+  for (std::size_t i = 0; i < size; ++i) {
+    int32_t offset = day[i] - first;
+    offset += (offset >> 31) & models::kDaysInLeapYear;
+    const int32_t year = first_year + (offset >= next_year_offset);
+    result[i] = (static_cast<uint32_t>(offset) < window_size) &
+                (day[i] != kDisabledDay) & (last_notified_year[i] < year);
+  }
+}
 
-    if (birthday == local_day) {
-      result[row.user_id].ids.push_back(row.id);
-      result[row.user_id].celebrate_today.push_back(row.person);
+namespace {
+
+template <typename Rows>
+std::unordered_map<models::UserId, BirthdaysToNotify> FindInRows(
+    const Rows& rows, const cctz::civil_day& local_day) {
+  const auto columns = MakeColumns(rows);
+  const auto table = MakeNotificationDayTable(local_day);
+  std::vector<uint8_t> selected;
+  SelectBirthdaysToNotify(columns, table, selected);
+
+  std::unordered_map<models::UserId, BirthdaysToNotify> result;
+  // occurrences of forgotten birthdays, appended to the ones celebrated today
+  // at the end
+  std::unordered_map<models::UserId, std::vector<models::BirthdayOccurrence>>
+      forgotten_occurrences;
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    if (!selected[i]) {
+      continue;
+    }
+    const auto& row = rows[i];
+    auto& birthdays = result[row.user_id];
+    const models::BirthdayOccurrence occurrence{
+        row.id, models::BirthdayYear{table.year[columns.day[i]]}};
+    if (table.is_today[columns.day[i]]) {
+      birthdays.occurrences.push_back(occurrence);
+      birthdays.celebrate_today.emplace_back(row.person);
     } else {
-      result[row.user_id].ids.push_back(row.id);
-      result[row.user_id].forgotten.push_back(
+      forgotten_occurrences[row.user_id].push_back(occurrence);
+      birthdays.forgotten.push_back(
           fmt::format("{} on {:02}.{:02}", row.person, row.d, row.m));
     }
   }
+  for (auto& [user_id, occurrences] : forgotten_occurrences) {
+    auto& birthdays = result[user_id].occurrences;
+    birthdays.insert(birthdays.end(), occurrences.begin(), occurrences.end());
+  }
   return result;
 }
 
+}  // namespace
+
+BirthdayColumns BirthdayColumns::FromRows(
+    const std::vector<models::Birthday>& rows) {
+  return MakeColumns(rows);
+}
+
+BirthdayColumns BirthdayColumns::FromRows(const models::BirthdayBatch& rows) {
+  return MakeColumns(rows);
+}
+
+std::unordered_map<models::UserId, BirthdaysToNotify> FindBirthdaysToNotify(
+    const std::vector<models::Birthday>& rows,
+    const cctz::civil_day& local_day) {
+  return FindInRows(rows, local_day);
+}
+
+std::unordered_map<models::UserId, BirthdaysToNotify> FindBirthdaysToNotify(
+    const models::BirthdayBatch& rows, const cctz::civil_day& local_day) {
+  return FindInRows(rows, local_day);
+}
+
 }  // namespace impl
 
 }  // namespace telegram_bot::components
@@ -1,20 +1,79 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <cctz/time_zone.h>
 
+#include <userver/concurrent/async_event_channel.hpp>
+#include <userver/dist_lock/dist_locked_worker.hpp>
+#include <userver/engine/condition_variable.hpp>
+#include <userver/engine/mutex.hpp>
 #include <userver/storages/postgres/dist_lock_component_base.hpp>
 #include <userver/storages/postgres/postgres_fwd.hpp>
+#include <userver/testsuite/tasks.hpp>
+#include <userver/utils/periodic_task.hpp>
+#include <userver/utils/statistics/entry.hpp>
+#include <userver/utils/statistics/percentile.hpp>
+#include <userver/utils/statistics/recentperiod.hpp>
 #include <userver/utils/time_of_day.hpp>
 
+#include <components/birthdays_cache.hpp>
 #include <components/bot/component.hpp>
+#include <models/birthday.hpp>
+#include <models/birthday_batch.hpp>
+#include <models/notification.hpp>
+#include <models/time_point.hpp>
 
 namespace telegram_bot::components {
 
+namespace impl {
+
+struct BirthdaysToNotify {
+  // occurrences of celebrate_today go first, then the ones of forgotten
+  std::vector<models::BirthdayOccurrence> occurrences;
+  std::vector<std::string> celebrate_today;
+  std::vector<std::string> forgotten;
+};
+
+struct NotificationSchedule {
+  cctz::time_zone timezone;
+  userver::utils::datetime::TimeOfDay<std::chrono::minutes> time_of_day;
+};
+
+// Milliseconds, exact up to a second and up to a minute with a second
+// precision
+using PhaseTimings = userver::utils::statistics::RecentPeriod<
+    userver::utils::statistics::Percentile<1000, uint32_t, 59, 1000>,
+    userver::utils::statistics::Percentile<1000, uint32_t, 59, 1000>>;
+
+struct Metrics {
+  std::atomic<int64_t> rows_scanned{};
+  std::atomic<int64_t> rows_matched{};
+  std::atomic<int64_t> users_planned{};
+  // users whose notifications were being sent, they are planned again later
+  std::atomic<int64_t> users_postponed{};
+  std::atomic<int64_t> failed_iterations{};
+  // Fetch is the time spent reading birthdays from the database or the cache,
+  // filter and plan are the time spent on the chunks read
+  PhaseTimings fetch_timings;
+  PhaseTimings filter_timings;
+  PhaseTimings plan_timings;
+  PhaseTimings iteration_timings;
+};
+
+}  // namespace impl
+
 class BirthdayNotificator final
     : public userver::storages::postgres::DistLockComponentBase {
  public:
@@ -30,29 +89,135 @@ class BirthdayNotificator final
  private:
   userver::storages::postgres::ClusterPtr postgres_;
   bot::Component& bot_;
+  userver::testsuite::TestsuiteTasks& testsuite_tasks_;
+  // set if birthdays are read from memory
+  const BirthdaysCache* birthdays_cache_{nullptr};
+  std::chrono::milliseconds calendar_cache_lag_{};
+  // defaults for users without settings of their own
   cctz::time_zone notification_timezone_;
   userver::utils::datetime::TimeOfDay<std::chrono::minutes>
       notification_time_of_day_;
+  std::size_t fetch_chunk_size_{};
+  std::chrono::milliseconds max_sleep_{};
+  std::chrono::milliseconds retry_delay_{};
+
+  // Wakes up sleeping iterations on birthdays changes, users whose buckets
+  // are to be planned again by shard index
+  userver::engine::Mutex changes_mutex_;
+  userver::engine::ConditionVariable changes_cv_;
+  std::vector<std::unordered_set<models::UserId>> changed_users_;
+  userver::concurrent::AsyncEventSubscriberScope
+      birthdays_changed_subscription_;
+
+  impl::Metrics metrics_;
+  userver::utils::statistics::Entry statistics_holder_;
+
+  // Sharded mode, every shard of users has its own lock and any instance may
+  // hold it. Every instance holds a lock of its own to be counted for
+  // rebalancing.
+  struct ShardWorker {
+    std::unique_ptr<userver::dist_lock::DistLockedWorker> worker;
+    std::optional<std::chrono::steady_clock::time_point> stopped_at;
+  };
+  std::string distlock_table_;
+  std::string shard_lock_prefix_;
+  std::string instance_lock_prefix_;
+  std::vector<ShardWorker> shard_workers_;
+  std::unique_ptr<userver::dist_lock::DistLockedWorker> instance_worker_;
+  std::chrono::milliseconds rebalance_period_{};
+  userver::utils::PeriodicTask rebalance_task_;
 
  private:
   void DoWork() override;
   void DoWorkTestsuite() override;
-  void RunIteration();
+  // a single iteration over all buckets, reads birthdays from the cache if
+  // it is set or from the database
+  void RunTestsuiteIterations(const BirthdaysCache* birthdays_cache);
+  // bucket key -> local day its users were notified on
+  using NotifiedDays = std::unordered_map<std::string, cctz::civil_day>;
+
+  void RunLoop(const models::UserShard& shard);
+  // returns when the bucket should be processed next time
+  models::TimePoint ProcessBucket(const models::UserShard& shard,
+                                  const models::NotificationBucket& bucket,
+                                  models::TimePoint now,
+                                  NotifiedDays& notified_days);
+  std::vector<models::NotificationBucket> FetchNotificationBuckets(
+      const models::UserShard& shard,
+      const BirthdaysCache* birthdays_cache) const;
+  // buckets the users are in now
+  std::vector<models::NotificationBucket> FetchNotificationBuckets(
+      const std::vector<models::UserId>& user_ids) const;
+  // throws on invalid user settings
+  impl::NotificationSchedule GetSchedule(
+      const models::NotificationBucket& bucket) const;
+  // returns false if the bucket is to be planned again after the retry delay,
+  // as the notification time is not reached or some users were postponed
+  bool RunIteration(const models::UserShard& shard,
+                    const models::NotificationBucket& bucket,
+                    const impl::NotificationSchedule& schedule,
+                    const BirthdaysCache* birthdays_cache);
+  // returns the shard users who changed birthdays or settings before
+  // `until`, empty on timeout
+  std::vector<models::UserId> WaitForChanges(const models::UserShard& shard,
+                                             models::TimePoint until);
+  void OnBirthdaysChanged(models::UserId user_id);
+  void StartShards(const userver::components::ComponentConfig& config,
+                   int32_t shards);
+  void RebalanceShards();
 };
 
 namespace impl {
 
-struct BirthdaysToNotify {
-  std::vector<models::BirthdayId> ids;
-  std::vector<std::string> celebrate_today;
-  std::vector<std::string> forgotten;
+models::TimePoint GetNotificationTime(
+    const cctz::civil_day& local_day,
+    const userver::utils::datetime::TimeOfDay<std::chrono::minutes>&
+        time_of_day,
+    const cctz::time_zone& notification_timezone);
+
+// Birthdays packed into columns for the notification filter
+struct BirthdayColumns {
+  // day of a leap year, kDisabledDay for disabled notification
+  std::vector<uint16_t> day;
+  // kNeverNotified if unset
+  std::vector<int32_t> last_notified_year;
+
+  static BirthdayColumns FromRows(const std::vector<models::Birthday>& rows);
+  static BirthdayColumns FromRows(const models::BirthdayBatch& rows);
 };
 
+inline constexpr uint16_t kDisabledDay = models::kDaysInLeapYear;
+inline constexpr int32_t kOutsideWindow = std::numeric_limits<int32_t>::min();
+inline constexpr int32_t kNeverNotified = kOutsideWindow + 1;
+
+// Built once per iteration, birthdays on a day of the window are notified if
+// the user was not notified about its occurrence in that year
+struct NotificationDayTable {
+  // year the day was celebrated in, kOutsideWindow for days out of the window
+  std::array<int32_t, kDisabledDay + 1> year;
+  std::array<uint8_t, kDisabledDay + 1> is_today;
+  // Days of the window are window_size days from window_first, they may
+  // cross the end of the year, the days before the crossing are of
+  // window_first_year and the ones after it of the next year
+  uint16_t window_first{};
+  uint16_t window_size{};
+  int32_t window_first_year{};
+};
+
+NotificationDayTable MakeNotificationDayTable(const cctz::civil_day& local_day);
+
+// Sets selected[i] to 1 for rows to be notified
+void SelectBirthdaysToNotify(const BirthdayColumns& columns,
+                             const NotificationDayTable& table,
+                             std::vector<uint8_t>& selected);
+
 std::unordered_map<models::UserId, BirthdaysToNotify> FindBirthdaysToNotify(
     const std::vector<models::Birthday>& rows,
-    const cctz::time_zone& notification_timezone,
     const cctz::civil_day& local_day);
 
+std::unordered_map<models::UserId, BirthdaysToNotify> FindBirthdaysToNotify(
+    const models::BirthdayBatch& rows, const cctz::civil_day& local_day);
+
 }  // namespace impl
 
 }  // namespace telegram_bot::components
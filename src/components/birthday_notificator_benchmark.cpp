@@ -0,0 +1,95 @@
+#include "birthday_notificator.hpp"
+
+#include <cstdint>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+std::vector<telegram_bot::models::Birthday> MakeBirthdays(std::size_t size) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> day_distribution(0, 365);
+  std::uniform_int_distribution<int> user_distribution(1, 100000);
+  std::bernoulli_distribution enabled_distribution(0.9);
+  std::bernoulli_distribution notified_distribution(0.5);
+
+  std::vector<telegram_bot::models::Birthday> birthdays;
+  birthdays.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto day =
+        cctz::civil_day(2000, 1, 1) + day_distribution(generator);
+    telegram_bot::models::Birthday birthday;
+    birthday.id = telegram_bot::models::BirthdayId{static_cast<int32_t>(i)};
+    birthday.person = "person";
+    birthday.m = telegram_bot::models::BirthdayMonth{day.month()};
+    birthday.d = telegram_bot::models::BirthdayDay{day.day()};
+    birthday.notification_enabled = enabled_distribution(generator);
+    if (notified_distribution(generator)) {
+      birthday.last_notified_year =
+          telegram_bot::models::BirthdayYear{notified_distribution(generator)
+                                                 ? 2022
+                                                 : 2023};
+    }
+    birthday.user_id =
+        telegram_bot::models::UserId{user_distribution(generator)};
+    birthdays.push_back(std::move(birthday));
+  }
+  return birthdays;
+}
+
+telegram_bot::models::BirthdayBatch MakeBatch(
+    const std::vector<telegram_bot::models::Birthday>& birthdays) {
+  std::size_t names_size = 0;
+  for (const auto& birthday : birthdays) {
+    names_size += birthday.person.size();
+  }
+
+  telegram_bot::models::BirthdayBatch batch(birthdays.size(), names_size);
+  for (const auto& birthday : birthdays) {
+    batch.Append({birthday.id, birthday.person, birthday.y, birthday.m,
+                  birthday.d, birthday.notification_enabled,
+                  birthday.last_notified_year, birthday.user_id});
+  }
+  return batch;
+}
+
+// The whole range takes minutes, so the ones above 100k rows run only if
+// TELEGRAM_BOT_BENCHMARK_FULL_RANGE is set
+#ifdef TELEGRAM_BOT_BENCHMARK_FULL_RANGE
+const int64_t kMaxRows = 10000000;
+#else
+const int64_t kMaxRows = 100000;
+#endif
+
+void BM_FindBirthdaysToNotify(benchmark::State& state) {
+  const auto local_day = cctz::civil_day(2023, 3, 15);
+  const auto birthdays = MakeBirthdays(state.range(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        telegram_bot::components::impl::FindBirthdaysToNotify(
+            birthdays, local_day));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindBirthdaysToNotify)
+    ->RangeMultiplier(10)
+    ->Range(1000, kMaxRows);
+
+void BM_FindBirthdaysToNotifyBatch(benchmark::State& state) {
+  const auto local_day = cctz::civil_day(2023, 3, 15);
+  const auto batch = MakeBatch(MakeBirthdays(state.range(0)));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        telegram_bot::components::impl::FindBirthdaysToNotify(batch,
+                                                              local_day));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindBirthdaysToNotifyBatch)
+    ->RangeMultiplier(10)
+    ->Range(1000, kMaxRows);
+
+}  // namespace
@@ -4,10 +4,15 @@
 #include <userver/utils/datetime/from_string_saturating.hpp>
 #include <userver/utils/mock_now.hpp>
 
+using telegram_bot::components::impl::BirthdayColumns;
 using telegram_bot::components::impl::FindBirthdaysToNotify;
+using telegram_bot::components::impl::GetNotificationTime;
+using telegram_bot::components::impl::MakeNotificationDayTable;
+using telegram_bot::components::impl::SelectBirthdaysToNotify;
 using telegram_bot::models::Birthday;
 using telegram_bot::models::BirthdayDay;
 using telegram_bot::models::BirthdayMonth;
+using telegram_bot::models::BirthdayYear;
 
 const telegram_bot::models::UserId kUserId1{1};
 const telegram_bot::models::UserId kUserId2{2};
@@ -27,70 +32,62 @@ UTEST(FindBirthdaysToNotify, BasicChecks) {
 
   auto result = FindBirthdaysToNotify(
       {
-          Birthday{
-              .person = "person1",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{16},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-16T15:00:00+0300"),
-              .user_id = kUserId1},
+          Birthday{.person = "person1",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{16},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
           Birthday{.person = "person2",
                    .m = BirthdayMonth{2},
                    .d = BirthdayDay{16},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
+                   .user_id = kUserId1},
+          Birthday{.person = "person3",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{16},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2023},
+                   .user_id = kUserId1},
+          Birthday{.person = "person4",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{15},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.person = "person5",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{12},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
                    .user_id = kUserId1},
-          Birthday{
-              .person = "person3",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{16},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2023-02-16T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person4",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{15},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-15T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person5",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{12},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-12T15:00:00+0300"),
-              .user_id = kUserId1},
           Birthday{.person = "person6",
                    .m = BirthdayMonth{2},
                    .d = BirthdayDay{16},
                    .notification_enabled = false,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId1},
           Birthday{.person = "person7",
                    .m = BirthdayMonth{2},
                    .d = BirthdayDay{17},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId1},
           Birthday{.person = "person8",
                    .m = BirthdayMonth{3},
                    .d = BirthdayDay{16},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId1},
           Birthday{.person = "person9",
                    .m = BirthdayMonth{1},
                    .d = BirthdayDay{16},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId1},
       },
-      moscow_timezone, local_day);
+      local_day);
   EXPECT_EQ(result.size(), 1);
   EXPECT_EQ(result[kUserId1].celebrate_today,
             std::vector<std::string>({"person1", "person2"}));
@@ -113,32 +110,26 @@ UTEST(FindBirthdaysToNotify, MonthBorder) {
 
   auto result = FindBirthdaysToNotify(
       {
-          Birthday{
-              .person = "person1",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{1},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-01T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person2",
-              .m = BirthdayMonth{1},
-              .d = BirthdayDay{31},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-01-31T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person3",
-              .m = BirthdayMonth{1},
-              .d = BirthdayDay{28},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-01-28T15:00:00+0300"),
-              .user_id = kUserId1},
+          Birthday{.person = "person1",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{1},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.person = "person2",
+                   .m = BirthdayMonth{1},
+                   .d = BirthdayDay{31},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.person = "person3",
+                   .m = BirthdayMonth{1},
+                   .d = BirthdayDay{28},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
       },
-      moscow_timezone, local_day);
+      local_day);
   EXPECT_EQ(result[kUserId1].celebrate_today,
             std::vector<std::string>({"person1"}));
   EXPECT_EQ(result[kUserId1].forgotten,
@@ -160,44 +151,88 @@ UTEST(FindBirthdaysToNotify, YearBorder) {
 
   auto result = FindBirthdaysToNotify(
       {
-          Birthday{
-              .person = "person1",
-              .m = BirthdayMonth{1},
-              .d = BirthdayDay{1},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-01-01T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person2",
-              .m = BirthdayMonth{12},
-              .d = BirthdayDay{31},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2021-12-31T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person3",
-              .m = BirthdayMonth{12},
-              .d = BirthdayDay{28},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2021-12-28T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person4",
-              .m = BirthdayMonth{12},
-              .d = BirthdayDay{31},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-12-31T15:00:00+0300"),
-              .user_id = kUserId1},
+          Birthday{.person = "person1",
+                   .m = BirthdayMonth{1},
+                   .d = BirthdayDay{1},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.person = "person2",
+                   .m = BirthdayMonth{12},
+                   .d = BirthdayDay{31},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2021},
+                   .user_id = kUserId1},
+          Birthday{.person = "person3",
+                   .m = BirthdayMonth{12},
+                   .d = BirthdayDay{28},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2021},
+                   .user_id = kUserId1},
+          Birthday{.person = "person4",
+                   .m = BirthdayMonth{12},
+                   .d = BirthdayDay{31},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
       },
-      moscow_timezone, local_day);
+      local_day);
   EXPECT_EQ(result[kUserId1].celebrate_today,
             std::vector<std::string>({"person1"}));
   EXPECT_EQ(result[kUserId1].forgotten,
             std::vector<std::string>{"person2 on 31.12"});
+  // occurrences are recorded in the year they were celebrated in
+  const auto& occurrences = result[kUserId1].occurrences;
+  ASSERT_EQ(occurrences.size(), 2);
+  EXPECT_EQ(occurrences[0].year.GetUnderlying(), 2023);
+  EXPECT_EQ(occurrences[1].year.GetUnderlying(), 2022);
+}
+
+UTEST(FindBirthdaysToNotify, OccurrencesFollowTitles) {
+  const auto local_day = cctz::civil_day(2023, 2, 16);
+
+  auto result = FindBirthdaysToNotify(
+      {
+          Birthday{.id = telegram_bot::models::BirthdayId{1},
+                   .person = "person1",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{15},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.id = telegram_bot::models::BirthdayId{2},
+                   .person = "person2",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{16},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.id = telegram_bot::models::BirthdayId{3},
+                   .person = "person3",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{14},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.id = telegram_bot::models::BirthdayId{4},
+                   .person = "person4",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{16},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+      },
+      local_day);
+  EXPECT_EQ(result[kUserId1].celebrate_today,
+            std::vector<std::string>({"person2", "person4"}));
+  EXPECT_EQ(result[kUserId1].forgotten,
+            std::vector<std::string>({"person1 on 15.02", "person3 on 14.02"}));
+  // the planner builds the text from the titles of the occurrences
+  std::vector<int> ids;
+  for (const auto& occurrence : result[kUserId1].occurrences) {
+    ids.push_back(occurrence.birthday_id.GetUnderlying());
+  }
+  EXPECT_EQ(ids, std::vector<int>({2, 4, 1, 3}));
 }
 
 UTEST(FindBirthdaysToNotify, TimezoneApplication) {
@@ -215,24 +250,20 @@ UTEST(FindBirthdaysToNotify, TimezoneApplication) {
 
   auto result = FindBirthdaysToNotify(
       {
-          Birthday{
-              .person = "person1",
-              .m = BirthdayMonth{1},
-              .d = BirthdayDay{1},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-01-01T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person2",
-              .m = BirthdayMonth{1},
-              .d = BirthdayDay{2},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-01-02T15:00:00+0300"),
-              .user_id = kUserId1},
+          Birthday{.person = "person1",
+                   .m = BirthdayMonth{1},
+                   .d = BirthdayDay{1},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
+          Birthday{.person = "person2",
+                   .m = BirthdayMonth{1},
+                   .d = BirthdayDay{2},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
       },
-      vladivostok_timezone, local_day);
+      local_day);
   EXPECT_EQ(result[kUserId1].celebrate_today,
             std::vector<std::string>({"person2"}));
   EXPECT_EQ(result[kUserId1].forgotten,
@@ -254,70 +285,62 @@ UTEST(FindBirthdaysToNotify, SplitUsers) {
 
   auto result = FindBirthdaysToNotify(
       {
-          Birthday{
-              .person = "person1",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{16},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-16T15:00:00+0300"),
-              .user_id = kUserId1},
+          Birthday{.person = "person1",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{16},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
           Birthday{.person = "person2",
                    .m = BirthdayMonth{2},
                    .d = BirthdayDay{16},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
+                   .user_id = kUserId2},
+          Birthday{.person = "person3",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{16},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2023},
+                   .user_id = kUserId1},
+          Birthday{.person = "person4",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{15},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
                    .user_id = kUserId2},
-          Birthday{
-              .person = "person3",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{16},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2023-02-16T15:00:00+0300"),
-              .user_id = kUserId1},
-          Birthday{
-              .person = "person4",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{15},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-15T15:00:00+0300"),
-              .user_id = kUserId2},
-          Birthday{
-              .person = "person5",
-              .m = BirthdayMonth{2},
-              .d = BirthdayDay{12},
-              .notification_enabled = true,
-              .last_notification_time = userver::utils::datetime::Stringtime(
-                  "2022-02-12T15:00:00+0300"),
-              .user_id = kUserId1},
+          Birthday{.person = "person5",
+                   .m = BirthdayMonth{2},
+                   .d = BirthdayDay{12},
+                   .notification_enabled = true,
+                   .last_notified_year = BirthdayYear{2022},
+                   .user_id = kUserId1},
           Birthday{.person = "person6",
                    .m = BirthdayMonth{2},
                    .d = BirthdayDay{16},
                    .notification_enabled = false,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId2},
           Birthday{.person = "person7",
                    .m = BirthdayMonth{2},
                    .d = BirthdayDay{17},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId1},
           Birthday{.person = "person8",
                    .m = BirthdayMonth{3},
                    .d = BirthdayDay{16},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId2},
           Birthday{.person = "person9",
                    .m = BirthdayMonth{1},
                    .d = BirthdayDay{16},
                    .notification_enabled = true,
-                   .last_notification_time = std::nullopt,
+                   .last_notified_year = std::nullopt,
                    .user_id = kUserId1},
       },
-      moscow_timezone, local_day);
+      local_day);
   EXPECT_EQ(result.size(), 2);
   EXPECT_EQ(result[kUserId1].celebrate_today,
             std::vector<std::string>({"person1"}));
@@ -327,3 +350,107 @@ UTEST(FindBirthdaysToNotify, SplitUsers) {
   EXPECT_EQ(result[kUserId2].forgotten,
             std::vector<std::string>{"person4 on 15.02"});
 }
+
+UTEST(GetNotificationTime, Basic) {
+  cctz::time_zone moscow_timezone;
+  ASSERT_TRUE(cctz::load_time_zone("Europe/Moscow", &moscow_timezone));
+
+  const userver::utils::datetime::TimeOfDay<std::chrono::minutes> time_of_day(
+      "10:30");
+  EXPECT_EQ(GetNotificationTime(cctz::civil_day(2023, 2, 16), time_of_day,
+                                moscow_timezone),
+            userver::utils::datetime::Stringtime("2023-02-16T10:30:00+0300"));
+  EXPECT_EQ(GetNotificationTime(cctz::civil_day(2023, 2, 17), time_of_day,
+                                moscow_timezone),
+            userver::utils::datetime::Stringtime("2023-02-17T10:30:00+0300"));
+}
+
+UTEST(GetNotificationTime, LateTimeOfDay) {
+  cctz::time_zone vladivostok_timezone;
+  ASSERT_TRUE(cctz::load_time_zone("Asia/Vladivostok", &vladivostok_timezone));
+
+  const userver::utils::datetime::TimeOfDay<std::chrono::minutes> time_of_day(
+      "23:55");
+  EXPECT_EQ(GetNotificationTime(cctz::civil_day(2022, 12, 31), time_of_day,
+                                vladivostok_timezone),
+            userver::utils::datetime::Stringtime("2022-12-31T23:55:00+1000"));
+}
+
+UTEST(SelectBirthdaysToNotify, Columns) {
+  const cctz::civil_day local_day(2023, 3, 1);
+
+  const auto columns = BirthdayColumns::FromRows({
+      Birthday{.person = "today",
+               .m = BirthdayMonth{3},
+               .d = BirthdayDay{1},
+               .notification_enabled = true,
+               .user_id = kUserId1},
+      Birthday{.person = "leap day",
+               .m = BirthdayMonth{2},
+               .d = BirthdayDay{29},
+               .notification_enabled = true,
+               .user_id = kUserId1},
+      Birthday{.person = "disabled",
+               .m = BirthdayMonth{3},
+               .d = BirthdayDay{1},
+               .notification_enabled = false,
+               .user_id = kUserId1},
+      Birthday{.person = "too old",
+               .m = BirthdayMonth{2},
+               .d = BirthdayDay{20},
+               .notification_enabled = true,
+               .user_id = kUserId1},
+      Birthday{.person = "notified",
+               .m = BirthdayMonth{2},
+               .d = BirthdayDay{27},
+               .notification_enabled = true,
+               .last_notified_year = BirthdayYear{2023},
+               .user_id = kUserId1},
+  });
+  const auto table = MakeNotificationDayTable(local_day);
+  std::vector<uint8_t> selected;
+  SelectBirthdaysToNotify(columns, table, selected);
+  EXPECT_EQ(selected, std::vector<uint8_t>({1, 1, 0, 0, 0}));
+  // Feb 29 is celebrated on Mar 1 in non-leap years
+  EXPECT_TRUE(table.is_today[columns.day[1]]);
+  EXPECT_EQ(table.window_size, 5);
+}
+
+UTEST(SelectBirthdaysToNotify, YearBorder) {
+  const cctz::civil_day local_day(2023, 1, 1);
+
+  const auto columns = BirthdayColumns::FromRows({
+      Birthday{.person = "today",
+               .m = BirthdayMonth{1},
+               .d = BirthdayDay{1},
+               .notification_enabled = true,
+               .last_notified_year = BirthdayYear{2022},
+               .user_id = kUserId1},
+      Birthday{.person = "forgotten",
+               .m = BirthdayMonth{12},
+               .d = BirthdayDay{30},
+               .notification_enabled = true,
+               .last_notified_year = BirthdayYear{2021},
+               .user_id = kUserId1},
+      Birthday{.person = "notified",
+               .m = BirthdayMonth{12},
+               .d = BirthdayDay{31},
+               .notification_enabled = true,
+               .last_notified_year = BirthdayYear{2022},
+               .user_id = kUserId1},
+      Birthday{.person = "too old",
+               .m = BirthdayMonth{12},
+               .d = BirthdayDay{28},
+               .notification_enabled = true,
+               .user_id = kUserId1},
+      Birthday{.person = "later",
+               .m = BirthdayMonth{1},
+               .d = BirthdayDay{2},
+               .notification_enabled = true,
+               .user_id = kUserId1},
+  });
+  const auto table = MakeNotificationDayTable(local_day);
+  std::vector<uint8_t> selected;
+  SelectBirthdaysToNotify(columns, table, selected);
+  EXPECT_EQ(selected, std::vector<uint8_t>({1, 1, 0, 0, 0}));
+}
@@ -0,0 +1,296 @@
+#include "birthdays_cache.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <utility>
+
+#include <userver/utils/assert.hpp>
+
+namespace telegram_bot::components {
+
+namespace {
+
+// Birthdays are updated along with settings of their users and the
+// notifications ledger, deleted birthdays come as tombstones. A row is stamped
+// with the latest of the three updates and comes from the branch of that
+// update only, so the incremental filter on calendar.updated_at is pushed
+// down into every branch as a range over an index of its own column.
+const std::string kCalendarQuery = R"(
+SELECT
+  calendar.id,
+  calendar.person,
+  calendar.y,
+  calendar.m,
+  calendar.d,
+  calendar.notification_enabled,
+  calendar.last_notified_year,
+  calendar.user_id,
+  calendar.timezone,
+  calendar.notification_time_of_day,
+  calendar.is_deleted
+FROM (
+  SELECT
+    birthdays.id,
+    birthdays.person,
+    birthdays.y,
+    birthdays.m,
+    birthdays.d,
+    birthdays.notification_enabled,
+    last_sent.year AS last_notified_year,
+    birthdays.user_id,
+    users.timezone,
+    to_char(users.notification_time, 'HH24:MI') AS notification_time_of_day,
+    false AS is_deleted,
+    birthdays.updated_at AS updated_at
+  FROM birthday.birthdays
+  JOIN birthday.users
+    ON users.id = birthdays.user_id
+  LEFT JOIN LATERAL (
+    SELECT
+      notifications_sent.year,
+      notifications_sent.notified_at
+    FROM birthday.notifications_sent
+    WHERE notifications_sent.birthday_id = birthdays.id
+    ORDER BY notifications_sent.year DESC
+    LIMIT 1
+  ) AS last_sent
+    ON true
+  WHERE birthdays.updated_at >= users.updated_at
+    AND (
+      last_sent.notified_at IS NULL
+      OR birthdays.updated_at >= last_sent.notified_at
+    )
+  UNION ALL
+  SELECT
+    birthdays.id,
+    birthdays.person,
+    birthdays.y,
+    birthdays.m,
+    birthdays.d,
+    birthdays.notification_enabled,
+    last_sent.year AS last_notified_year,
+    birthdays.user_id,
+    users.timezone,
+    to_char(users.notification_time, 'HH24:MI') AS notification_time_of_day,
+    false AS is_deleted,
+    users.updated_at AS updated_at
+  FROM birthday.birthdays
+  JOIN birthday.users
+    ON users.id = birthdays.user_id
+  LEFT JOIN LATERAL (
+    SELECT
+      notifications_sent.year,
+      notifications_sent.notified_at
+    FROM birthday.notifications_sent
+    WHERE notifications_sent.birthday_id = birthdays.id
+    ORDER BY notifications_sent.year DESC
+    LIMIT 1
+  ) AS last_sent
+    ON true
+  WHERE users.updated_at > birthdays.updated_at
+    AND (
+      last_sent.notified_at IS NULL
+      OR users.updated_at >= last_sent.notified_at
+    )
+  UNION ALL
+  SELECT
+    birthdays.id,
+    birthdays.person,
+    birthdays.y,
+    birthdays.m,
+    birthdays.d,
+    birthdays.notification_enabled,
+    notifications_sent.year,
+    birthdays.user_id,
+    users.timezone,
+    to_char(users.notification_time, 'HH24:MI'),
+    false,
+    notifications_sent.notified_at
+  FROM birthday.notifications_sent
+  JOIN birthday.birthdays
+    ON birthdays.id = notifications_sent.birthday_id
+  JOIN birthday.users
+    ON users.id = birthdays.user_id
+  WHERE notifications_sent.notified_at > birthdays.updated_at
+    AND notifications_sent.notified_at > users.updated_at
+    AND NOT EXISTS (
+      SELECT 1
+      FROM birthday.notifications_sent AS later_sent
+      WHERE later_sent.birthday_id = notifications_sent.birthday_id
+        AND later_sent.year > notifications_sent.year
+    )
+  UNION ALL
+  SELECT
+    deleted_birthdays.id,
+    '',
+    NULL::INTEGER,
+    0,
+    0,
+    false,
+    NULL::INTEGER,
+    deleted_birthdays.user_id,
+    NULL::TEXT,
+    NULL::TEXT,
+    true,
+    deleted_birthdays.deleted_at
+  FROM birthday.deleted_birthdays
+) AS calendar
+)";
+
+std::size_t GetDayIndex(const int month, const int day) {
+  return models::GetDayOfLeapYear(models::BirthdayMonth{month},
+                                  models::BirthdayDay{day});
+}
+
+std::size_t GetDayIndex(const models::CalendarBirthday& birthday) {
+  return models::GetDayOfLeapYear(birthday.m, birthday.d);
+}
+
+bool IsInBucket(const models::CalendarBirthday& birthday,
+                const models::NotificationBucket& bucket) {
+  return birthday.timezone == bucket.timezone &&
+         birthday.notification_time_of_day == bucket.notification_time_of_day;
+}
+
+bool IsInShard(const models::UserId user_id, const models::UserShard& shard) {
+  return user_id.GetUnderlying() % shard.count == shard.index;
+}
+
+models::Birthday ToBirthday(const models::CalendarBirthday& birthday) {
+  return {birthday.id,
+          birthday.person,
+          birthday.y,
+          birthday.m,
+          birthday.d,
+          birthday.notification_enabled,
+          birthday.last_notified_year,
+          birthday.user_id};
+}
+
+using BucketSet =
+    std::set<std::pair<std::optional<std::string>, std::optional<std::string>>>;
+
+std::vector<models::NotificationBucket> ToVector(const BucketSet& buckets) {
+  std::vector<models::NotificationBucket> result;
+  result.reserve(buckets.size());
+  for (const auto& [timezone, notification_time_of_day] : buckets) {
+    result.push_back({timezone, notification_time_of_day});
+  }
+  return result;
+}
+
+}  // namespace
+
+void BirthdayCalendar::insert_or_assign(models::BirthdayId id,
+                                        models::CalendarBirthday birthday) {
+  Erase(id);
+  if (birthday.is_deleted) {
+    return;
+  }
+
+  user_birthdays_[birthday.user_id].push_back(id);
+  if (birthday.notification_enabled) {
+    days_[GetDayIndex(birthday)].push_back(id);
+  }
+  birthdays_.emplace(id, std::move(birthday));
+}
+
+std::size_t BirthdayCalendar::size() const { return birthdays_.size(); }
+
+std::vector<models::Birthday> BirthdayCalendar::GetBirthdaysInWindow(
+    const cctz::civil_day& first_day, const cctz::civil_day& last_day,
+    const models::UserShard& shard,
+    const models::NotificationBucket& bucket) const {
+  UINVARIANT(first_day <= last_day && last_day - first_day < 365,
+             "Birthdays window must be shorter than a year");
+
+  // Feb 29 is in the window of a non-leap year if Feb 28 and Mar 1 are
+  const auto first_index = GetDayIndex(first_day.month(), first_day.day());
+  const auto last_index = GetDayIndex(last_day.month(), last_day.day());
+  const bool wraps = first_day.year() != last_day.year();
+
+  std::vector<models::Birthday> result;
+  const auto collect = [&](const std::size_t first, const std::size_t last) {
+    for (auto index = first; index <= last; ++index) {
+      for (const auto id : days_[index]) {
+        const auto& birthday = birthdays_.at(id);
+        if (IsInShard(birthday.user_id, shard) &&
+            IsInBucket(birthday, bucket)) {
+          result.push_back(ToBirthday(birthday));
+        }
+      }
+    }
+  };
+  if (wraps) {
+    collect(first_index, models::kDaysInLeapYear - 1);
+    collect(0, last_index);
+  } else {
+    collect(first_index, last_index);
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const models::Birthday& lhs, const models::Birthday& rhs) {
+              return std::tie(lhs.user_id, lhs.id) <
+                     std::tie(rhs.user_id, rhs.id);
+            });
+  return result;
+}
+
+std::vector<models::NotificationBucket>
+BirthdayCalendar::GetNotificationBuckets(
+    const models::UserShard& shard) const {
+  BucketSet buckets;
+  for (const auto& [user_id, ids] : user_birthdays_) {
+    if (!IsInShard(user_id, shard)) {
+      continue;
+    }
+    // settings are the same in all birthdays of a user
+    const auto& birthday = birthdays_.at(ids.front());
+    buckets.emplace(birthday.timezone, birthday.notification_time_of_day);
+  }
+  return ToVector(buckets);
+}
+
+std::vector<models::NotificationBucket>
+BirthdayCalendar::GetNotificationBuckets(
+    const std::vector<models::UserId>& user_ids) const {
+  BucketSet buckets;
+  for (const auto user_id : user_ids) {
+    const auto it = user_birthdays_.find(user_id);
+    if (it == user_birthdays_.end()) {
+      continue;
+    }
+    // settings are the same in all birthdays of a user
+    const auto& birthday = birthdays_.at(it->second.front());
+    buckets.emplace(birthday.timezone, birthday.notification_time_of_day);
+  }
+  return ToVector(buckets);
+}
+
+void BirthdayCalendar::Erase(const models::BirthdayId id) {
+  const auto it = birthdays_.find(id);
+  if (it == birthdays_.end()) {
+    return;
+  }
+
+  const auto erase_id = [id](std::vector<models::BirthdayId>& ids) {
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+  };
+  const auto user_it = user_birthdays_.find(it->second.user_id);
+  if (user_it != user_birthdays_.end()) {
+    erase_id(user_it->second);
+    if (user_it->second.empty()) {
+      user_birthdays_.erase(user_it);
+    }
+  }
+  if (it->second.notification_enabled) {
+    erase_id(days_[GetDayIndex(it->second)]);
+  }
+  birthdays_.erase(it);
+}
+
+std::string BirthdaysCachePolicy::GetQuery() { return kCalendarQuery; }
+
+}  // namespace telegram_bot::components
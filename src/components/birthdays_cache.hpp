@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cctz/civil_time.h>
+
+#include <userver/cache/base_postgres_cache.hpp>
+#include <userver/storages/postgres/io/chrono.hpp>
+
+#include <models/birthday.hpp>
+#include <models/user.hpp>
+
+namespace telegram_bot::components {
+
+// All birthdays bucketed by (month, day) of a leap year with a per-user index
+class BirthdayCalendar {
+ public:
+  // Container interface of the cache, tombstones remove birthdays
+  void insert_or_assign(models::BirthdayId id,
+                        models::CalendarBirthday birthday);
+  std::size_t size() const;
+
+  // Only birthdays of the shard users from the notification bucket with enabled
+  // notification which (m, d) fall into the [first_day, last_day] window, the
+  // window may cross the new year. Ordered by user.
+  std::vector<models::Birthday> GetBirthdaysInWindow(
+      const cctz::civil_day& first_day, const cctz::civil_day& last_day,
+      const models::UserShard& shard,
+      const models::NotificationBucket& bucket) const;
+
+  // Buckets of the shard users which have birthdays
+  std::vector<models::NotificationBucket> GetNotificationBuckets(
+      const models::UserShard& shard) const;
+
+  // Buckets of the users which have birthdays
+  std::vector<models::NotificationBucket> GetNotificationBuckets(
+      const std::vector<models::UserId>& user_ids) const;
+
+ private:
+  void Erase(models::BirthdayId id);
+
+  std::unordered_map<models::BirthdayId, models::CalendarBirthday> birthdays_;
+  std::unordered_map<models::UserId, std::vector<models::BirthdayId>>
+      user_birthdays_;
+  // enabled birthdays only
+  std::array<std::vector<models::BirthdayId>, models::kDaysInLeapYear> days_;
+};
+
+struct BirthdaysCachePolicy {
+  static constexpr std::string_view kName = "birthdays-cache";
+
+  using ValueType = models::CalendarBirthday;
+  using CacheContainer = BirthdayCalendar;
+  static constexpr auto kKeyMember = &models::CalendarBirthday::id;
+  static std::string GetQuery();
+  static constexpr const char* kUpdatedField = "calendar.updated_at";
+  using UpdatedFieldType = userver::storages::postgres::TimePointTz;
+  // notified birthdays must be seen without replication lag
+  static constexpr auto kClusterHostType =
+      userver::storages::postgres::ClusterHostType::kMaster;
+};
+
+using BirthdaysCache = userver::components::PostgreCache<BirthdaysCachePolicy>;
+
+}  // namespace telegram_bot::components
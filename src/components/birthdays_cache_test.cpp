@@ -0,0 +1,130 @@
+#include "birthdays_cache.hpp"
+
+#include <userver/utest/utest.hpp>
+
+using telegram_bot::components::BirthdayCalendar;
+using telegram_bot::models::BirthdayDay;
+using telegram_bot::models::BirthdayId;
+using telegram_bot::models::BirthdayMonth;
+using telegram_bot::models::CalendarBirthday;
+using telegram_bot::models::NotificationBucket;
+using telegram_bot::models::UserId;
+using telegram_bot::models::UserShard;
+
+namespace {
+
+const UserId kUserId1{1};
+const UserId kUserId2{2};
+const UserShard kAllUsers{};
+const NotificationBucket kDefaultBucket{};
+
+CalendarBirthday MakeBirthday(int id, int m, int d, UserId user_id,
+                              bool notification_enabled = true) {
+  return CalendarBirthday{.id = BirthdayId{id},
+                          .person = "person" + std::to_string(id),
+                          .m = BirthdayMonth{m},
+                          .d = BirthdayDay{d},
+                          .notification_enabled = notification_enabled,
+                          .user_id = user_id};
+}
+
+std::vector<int> GetIds(
+    const std::vector<telegram_bot::models::Birthday>& birthdays) {
+  std::vector<int> ids;
+  for (const auto& birthday : birthdays) {
+    ids.push_back(birthday.id.GetUnderlying());
+  }
+  return ids;
+}
+
+void Insert(BirthdayCalendar& calendar, CalendarBirthday birthday) {
+  const auto id = birthday.id;
+  calendar.insert_or_assign(id, std::move(birthday));
+}
+
+}  // namespace
+
+TEST(BirthdayCalendar, Window) {
+  BirthdayCalendar calendar;
+  Insert(calendar, MakeBirthday(1, 3, 14, kUserId2));
+  Insert(calendar, MakeBirthday(2, 3, 16, kUserId1));
+  Insert(calendar, MakeBirthday(3, 3, 10, kUserId1));
+  Insert(calendar, MakeBirthday(4, 3, 12, kUserId1));
+  Insert(calendar, MakeBirthday(5, 3, 15, kUserId1, false));
+  EXPECT_EQ(calendar.size(), 5);
+
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(
+                cctz::civil_day(2023, 3, 11), cctz::civil_day(2023, 3, 15),
+                kAllUsers, kDefaultBucket)),
+            (std::vector<int>{4, 1}));
+}
+
+TEST(BirthdayCalendar, WindowCrossesNewYear) {
+  BirthdayCalendar calendar;
+  Insert(calendar, MakeBirthday(1, 12, 30, kUserId1));
+  Insert(calendar, MakeBirthday(2, 1, 2, kUserId1));
+  Insert(calendar, MakeBirthday(3, 1, 5, kUserId1));
+  Insert(calendar, MakeBirthday(4, 12, 20, kUserId1));
+
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(
+                cctz::civil_day(2022, 12, 29), cctz::civil_day(2023, 1, 3),
+                kAllUsers, kDefaultBucket)),
+            (std::vector<int>{1, 2}));
+}
+
+TEST(BirthdayCalendar, LeapDayInNonLeapYear) {
+  BirthdayCalendar calendar;
+  Insert(calendar, MakeBirthday(1, 2, 29, kUserId1));
+
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(
+                cctz::civil_day(2023, 2, 25), cctz::civil_day(2023, 3, 1),
+                kAllUsers, kDefaultBucket)),
+            (std::vector<int>{1}));
+}
+
+TEST(BirthdayCalendar, ShardAndBucket) {
+  BirthdayCalendar calendar;
+  Insert(calendar, MakeBirthday(1, 3, 15, kUserId1));
+  auto birthday = MakeBirthday(2, 3, 15, kUserId2);
+  birthday.timezone = "Asia/Yekaterinburg";
+  Insert(calendar, std::move(birthday));
+
+  const cctz::civil_day day(2023, 3, 15);
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(day, day, kAllUsers,
+                                                 kDefaultBucket)),
+            (std::vector<int>{1}));
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(
+                day, day, kAllUsers, {"Asia/Yekaterinburg", std::nullopt})),
+            (std::vector<int>{2}));
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(day, day, UserShard{0, 2},
+                                                 kDefaultBucket)),
+            (std::vector<int>{}));
+
+  const auto buckets = calendar.GetNotificationBuckets(kAllUsers);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0].timezone, std::nullopt);
+  EXPECT_EQ(buckets[1].timezone, "Asia/Yekaterinburg");
+
+  const auto user_buckets = calendar.GetNotificationBuckets(
+      std::vector<UserId>{kUserId2, UserId{3}});
+  ASSERT_EQ(user_buckets.size(), 1);
+  EXPECT_EQ(user_buckets[0].timezone, "Asia/Yekaterinburg");
+}
+
+TEST(BirthdayCalendar, UpdateAndDelete) {
+  BirthdayCalendar calendar;
+  Insert(calendar, MakeBirthday(1, 3, 15, kUserId1));
+  Insert(calendar, MakeBirthday(2, 3, 16, kUserId1));
+  Insert(calendar, MakeBirthday(1, 4, 1, kUserId1));
+
+  auto tombstone = MakeBirthday(2, 0, 0, kUserId1);
+  tombstone.is_deleted = true;
+  Insert(calendar, std::move(tombstone));
+
+  EXPECT_EQ(calendar.size(), 1);
+  EXPECT_EQ(GetIds(calendar.GetBirthdaysInWindow(
+                cctz::civil_day(2023, 3, 10), cctz::civil_day(2023, 4, 1),
+                kAllUsers, kDefaultBucket)),
+            (std::vector<int>{1}));
+  EXPECT_EQ(calendar.GetNotificationBuckets(kAllUsers).size(), 1);
+}
@@ -10,7 +10,7 @@ namespace {
 
 const std::string kComponentConfigSchema = R"(
 type: object
-description: ClickHouse client component
+description: Telegram bot, receives commands of users and sends them messages
 additionalProperties: false
 properties:
     chat_id:
@@ -19,6 +19,87 @@ properties:
     telegram_host:
         description: Host to connect to
         type: string
+    global_messages_per_second:
+        description: Maximum rate of outgoing messages
+        type: number
+        minimum: 1
+        defaultDescription: 30
+    chat_messages_per_second:
+        description: Maximum rate of outgoing messages to a single chat
+        type: number
+        minimum: 1
+        defaultDescription: 1
+    default_timezone:
+        description: Timezone of users which have not set their own
+        type: string
+        defaultDescription: Europe/Moscow
+    chat_messages_burst:
+        description: Number of messages which can be sent to a chat at once
+        type: number
+        minimum: 1
+        defaultDescription: 3
+    long_poll_limit:
+        description: Maximum number of updates received by a getUpdates
+        type: integer
+        minimum: 1
+        maximum: 100
+        defaultDescription: 100
+    long_poll_timeout:
+        description: Time telegram holds getUpdates if there are no updates
+        type: string
+        defaultDescription: 50s
+    long_poll_allowed_updates:
+        description: Update types to receive
+        type: array
+        items:
+            type: string
+            description: update type, e.g. message
+        defaultDescription: all the types
+    update_task_processor:
+        description: Task processor to handle updates on
+        type: string
+        defaultDescription: main-task-processor
+    max_updates_in_flight:
+        description: |
+            Maximum number of updates queued or being handled, receiving
+            updates waits for the others to finish
+        type: integer
+        minimum: 1
+        defaultDescription: 100
+    telegram_methods:
+        description: Timeouts and retries of Bot API methods by the method name
+        type: object
+        properties: {}
+        additionalProperties:
+            type: object
+            description: settings of the method, e.g. of sendMessage
+            additionalProperties: false
+            properties:
+                timeout:
+                    description: |
+                        Request timeout, getUpdates is also held by telegram
+                        for long_poll_timeout
+                    type: string
+                    defaultDescription: 10s
+                attempts:
+                    description: |
+                        Attempts including the first one, a retried
+                        sendMessage may be delivered twice
+                    type: integer
+                    minimum: 1
+                    defaultDescription: 1
+    use_http2:
+        description: |
+            Multiplex the requests to telegram_host over a single HTTP/2
+            connection, plain http hosts keep using HTTP/1.1
+        type: boolean
+        defaultDescription: false
+    webhook_url:
+        description: |
+            Public url of handler-telegram-webhook, updates are pushed there
+            instead of long polling, requires telegram_webhook_secret in secdist
+        type: string
+        defaultDescription: empty, updates are polled
 )";
 
 }  // namespace
@@ -39,7 +120,7 @@ Component::~Component() = default;
 
 void Component::SendMessage(const models::ChatId chat_id,
                             const std::string& text) const {
-  impl_->SendMessage(chat_id, text);
+  impl_->SendBulkMessage(chat_id, text);
 }
 
 void Component::SendMessageWithKeyboard(
@@ -48,4 +129,17 @@ void Component::SendMessageWithKeyboard(
   impl_->SendMessageWithKeyboard(chat_id, text, button_rows);
 }
 
+bool Component::IsValidWebhookSecret(const std::string_view secret) const {
+  return impl_->IsValidWebhookSecret(secret);
+}
+
+void Component::HandleUpdate(const std::string& update_json) const {
+  impl_->HandleUpdate(update_json);
+}
+
+userver::concurrent::AsyncEventChannel<models::UserId>&
+Component::GetBirthdaysChangedChannel() const {
+  return impl_->GetBirthdaysChangedChannel();
+}
+
 }  // namespace telegram_bot::components::bot
@@ -2,9 +2,11 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <userver/components/loggable_component_base.hpp>
+#include <userver/concurrent/async_event_channel.hpp>
 #include <userver/yaml_config/schema.hpp>
 
 #include <models/button.hpp>
@@ -26,11 +28,22 @@ class Component final : public userver::components::LoggableComponentBase {
             const userver::components::ComponentContext&);
   virtual ~Component() override;
 
+  // Sent with bulk priority, replies to user commands go first
   void SendMessage(models::ChatId chat_id, const std::string& text) const;
   void SendMessageWithKeyboard(
       models::ChatId chat_id, const std::string& text,
       const std::vector<std::vector<models::Button>>& button_rows) const;
 
+  // Updates pushed by telegram to handler-telegram-webhook, the request is
+  // trusted only if it carries the webhook secret from secdist
+  bool IsValidWebhookSecret(std::string_view secret) const;
+  // Dispatches the update to the command handlers, throws if it is malformed
+  void HandleUpdate(const std::string& update_json) const;
+
+  // Notified when a user adds a birthday
+  userver::concurrent::AsyncEventChannel<models::UserId>&
+  GetBirthdaysChangedChannel() const;
+
   static userver::yaml_config::Schema GetStaticConfigSchema();
 
  private:
@@ -1,9 +1,12 @@
 #include "component.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <regex>
-#include <tuple>
 
 #include <cctz/time_zone.h>
 #include <fmt/format.h>
@@ -12,38 +15,44 @@
 #include <userver/components/component_config.hpp>
 #include <userver/components/component_context.hpp>
 #include <userver/components/statistics_storage.hpp>
+#include <userver/crypto/algorithm.hpp>
 #include <userver/engine/sleep.hpp>
 #include <userver/engine/task/cancel.hpp>
+#include <userver/formats/json/serialize.hpp>
 #include <userver/formats/json/value.hpp>
 #include <userver/logging/log.hpp>
 #include <userver/storages/postgres/component.hpp>
 #include <userver/storages/secdist/component.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
 #include <userver/tracing/span.hpp>
 #include <userver/utils/async.hpp>
+#include <userver/utils/datetime.hpp>
+#include <userver/utils/statistics/writer.hpp>
 #include <userver/yaml_config/merge_schemas.hpp>
 
-#include <tgbot/types/InlineKeyboardButton.h>
-#include <tgbot/types/InlineKeyboardMarkup.h>
-
 #include <components/bot/impl/reply_markup.hpp>
 #include <db/birthdays.hpp>
 #include <db/users.hpp>
+#include <utils/statistics.hpp>
 
 namespace telegram_bot::components::bot::impl {
 
 namespace {
 
-struct Token {
+struct Secrets {
   std::string token;
+  std::string webhook_secret;
 
-  Token(const userver::formats::json::Value& doc)
-      : token(doc["telegram_token"].As<std::string>()) {}
+  Secrets(const userver::formats::json::Value& doc)
+      : token(doc["telegram_token"].As<std::string>()),
+        webhook_secret(
+            doc["telegram_webhook_secret"].As<std::string>(std::string{})) {}
 };
 
-std::string GetToken(const userver::components::ComponentContext& context) {
+const Secrets& GetSecrets(
+    const userver::components::ComponentContext& context) {
   const auto& secdist = context.FindComponent<userver::components::Secdist>();
-  const auto& secdist_config = secdist.Get();
-  return secdist_config.Get<Token>().token;
+  return secdist.Get().Get<Secrets>();
 }
 
 struct MessageWithOptionalKeyboard {
@@ -53,44 +62,93 @@ struct MessageWithOptionalKeyboard {
 
 const int32_t kNextBirthdaysLimitNew = 6;
 
+const int kMaxThrottledAttempts = 3;
+
+// Concurrent webhook requests telegram makes to a single url
+const int32_t kWebhookMaxConnections = 40;
+
+const std::size_t kDefaultMaxUpdatesInFlight = 100;
+
+const std::chrono::seconds kPollRetryDelay{1};
+
+// telegram redelivers an update within minutes, far fewer than that many
+// updates arrive meanwhile
+const std::size_t kMaxSeenUpdates = 10000;
+
+// tests reuse update ids, they forget the updates seen before each test
+const std::string kForgetUpdatesTaskName = "telegram-bot-forget-updates";
+
+LongPollSettings GetLongPollSettings(
+    const userver::components::ComponentConfig& config) {
+  LongPollSettings settings;
+  settings.limit = config["long_poll_limit"].As<int32_t>(settings.limit);
+  settings.timeout = config["long_poll_timeout"].As<std::chrono::seconds>(
+      settings.timeout);
+  settings.allowed_updates =
+      config["long_poll_allowed_updates"].As<std::vector<std::string>>(
+          std::vector<std::string>{});
+  return settings;
+}
+
+TelegramClientSettings GetTelegramClientSettings(
+    const userver::components::ComponentConfig& config) {
+  TelegramClientSettings settings;
+  const auto methods = config["telegram_methods"];
+  if (!methods.IsMissing()) {
+    for (auto it = methods.begin(); it != methods.end(); ++it) {
+      TelegramMethodSettings method;
+      method.timeout =
+          (*it)["timeout"].As<std::chrono::milliseconds>(method.timeout);
+      method.attempts = (*it)["attempts"].As<int>(method.attempts);
+      settings.methods.emplace(it.GetName(), method);
+    }
+  }
+  settings.use_http2 = config["use_http2"].As<bool>(settings.use_http2);
+  return settings;
+}
+
+SendSchedulerSettings GetSendSchedulerSettings(
+    const userver::components::ComponentConfig& config) {
+  SendSchedulerSettings settings;
+  settings.global_messages_per_second =
+      config["global_messages_per_second"].As<double>(
+          settings.global_messages_per_second);
+  settings.chat_messages_per_second =
+      config["chat_messages_per_second"].As<double>(
+          settings.chat_messages_per_second);
+  settings.chat_messages_burst = config["chat_messages_burst"].As<double>(
+      settings.chat_messages_burst);
+  return settings;
+}
+
+cctz::civil_day GetLocalDay(const models::User& user,
+                            const cctz::time_zone& default_timezone) {
+  cctz::time_zone user_timezone = default_timezone;
+  if (user.timezone.has_value() &&
+      !cctz::load_time_zone(*user.timezone, &user_timezone)) {
+    throw std::runtime_error("Unknown timezone " + *user.timezone);
+  }
+  const auto now = userver::utils::datetime::Now();
+  LOG_DEBUG() << "at " << userver::utils::datetime::Timestring(now);
+  return cctz::civil_day(cctz::convert(now, user_timezone));
+}
+
 MessageWithOptionalKeyboard GetNextBirthdaysMessage(
-    const models::ChatId chat_id,
+    const std::optional<models::User>& user,
+    const cctz::time_zone& default_timezone,
     userver::storages::postgres::Cluster& postgres) {
-  const auto user_id = db::FindUser(chat_id, postgres);
-  if (!user_id.has_value()) {
+  if (!user.has_value()) {
     return {"You are not registered yet", {}};
   }
 
-  auto list = db::FetchBirthdays(*user_id, postgres);
+  const auto local_day = GetLocalDay(*user, default_timezone);
+  // read from the database, so the list shows the writes the user just made
+  const auto list = db::FetchNextBirthdays(user->id, local_day,
+                                           kNextBirthdaysLimitNew, postgres);
   if (list.empty()) {
     return {"There are no birthdays", {}};
   }
 
-  cctz::time_zone notification_timezone;
-  if (!cctz::load_time_zone("Europe/Moscow", &notification_timezone)) {
-    throw std::runtime_error("Unknown timezone Europe/Moscow");
-  }
-  const auto now = userver::utils::datetime::Now();
-  LOG_DEBUG() << "at " << userver::utils::datetime::Timestring(now);
-  const auto local_time = cctz::convert(now, notification_timezone);
-  const auto local_day = cctz::civil_day(local_time);
-
-  std::sort(
-      list.begin(), list.end(),
-      [local_day](const models::Birthday& lhs, const models::Birthday& rhs) {
-        const int l_year = std::tuple(lhs.m, lhs.d) <
-                           std::tuple(models::BirthdayMonth{local_day.month()},
-                                      models::BirthdayDay{local_day.day()});
-        const int r_year = std::tuple(rhs.m, rhs.d) <
-                           std::tuple(models::BirthdayMonth{local_day.month()},
-                                      models::BirthdayDay{local_day.day()});
-        return std::tuple(l_year, lhs.m, lhs.d) <
-               std::tuple(r_year, rhs.m, rhs.d);
-      });
-  if (list.size() > kNextBirthdaysLimitNew) {
-    list.resize(kNextBirthdaysLimitNew);
-  }
-
   std::string message = fmt::format("Next {} birthdays:", list.size());
   std::vector<std::vector<models::Button>> keyboard;
   for (const auto& birthday : list) {
@@ -108,13 +166,33 @@ MessageWithOptionalKeyboard GetNextBirthdaysMessage(
 Component::Component(const userver::components::ComponentConfig& config,
                      const userver::components::ComponentContext& context)
     : telegram_client_{context.FindComponent<userver::components::HttpClient>()
-                           .GetHttpClient()},
-      telegram_token_(GetToken(context)),
-      telegram_host_(config["telegram_host"].As<std::string>()),
-      bot_(telegram_token_, telegram_client_, telegram_host_),
+                           .GetHttpClient(),
+                       config["telegram_host"].As<std::string>(),
+                       GetSecrets(context).token,
+                       GetTelegramClientSettings(config)},
+      webhook_secret_(GetSecrets(context).webhook_secret),
       postgres_(
           context.FindComponent<userver::components::Postgres>("postgres-db")
-              .GetCluster()) {
+              .GetCluster()),
+      users_cache_(context.FindComponent<UsersCache>().GetCache()),
+      send_scheduler_(GetSendSchedulerSettings(config)),
+      long_poll_settings_(GetLongPollSettings(config)),
+      update_dispatcher_(
+          context.GetTaskProcessor(
+              config["update_task_processor"].As<std::string>(
+                  "main-task-processor")),
+          config["max_updates_in_flight"].As<std::size_t>(
+              kDefaultMaxUpdatesInFlight)),
+      seen_updates_(kMaxSeenUpdates),
+      testsuite_tasks_(
+          context.FindComponent<userver::components::TestsuiteSupport>()
+              .GetTestsuiteTasks()) {
+  const auto default_timezone =
+      config["default_timezone"].As<std::string>("Europe/Moscow");
+  if (!cctz::load_time_zone(default_timezone, &default_timezone_)) {
+    throw std::runtime_error("Unknown timezone " + default_timezone);
+  }
+
   auto& storage =
       context.FindComponent<userver::components::StatisticsStorage>()
           .GetStorage();
@@ -123,12 +201,63 @@ Component::Component(const userver::components::ComponentConfig& config,
       kName, [this](userver::utils::statistics::Writer& writer) {
         writer["received-commands"] = metrics_.received_commands;
         writer["received-callbacks"] = metrics_.received_callbacks;
+        writer["received-webhook-updates"] = metrics_.received_webhook_updates;
         writer["sent-messages"] = metrics_.sent_messages;
         writer["updated-messages"] = metrics_.updated_messages;
+        writer["throttled-requests"] = metrics_.throttled_requests;
+        writer["updates-in-flight"] = update_dispatcher_.GetInFlight();
+        writer["send-queue"]["interactive"] =
+            send_scheduler_.GetQueueSize(SendPriority::kInteractive);
+        writer["send-queue"]["bulk"] =
+            send_scheduler_.GetQueueSize(SendPriority::kBulk);
+        utils::WritePercentiles(writer["send-wait-time-ms"],
+                                send_scheduler_.GetWaitTimings());
+        writer["long-poll"]["polls"] = metrics_.polls;
+        writer["long-poll"]["errors"] = metrics_.poll_errors;
+        writer["long-poll"]["updates"] = metrics_.polled_updates;
+        utils::WritePercentiles(writer["long-poll"]["time-ms"],
+                                metrics_.poll_timings);
+        utils::WritePercentiles(writer["long-poll"]["batch-size"],
+                                metrics_.poll_batch_sizes);
+        for (const auto& [method, statistics] :
+             telegram_client_.GetStatistics()) {
+          writer["api"][method]["errors"] = statistics.errors;
+          utils::WritePercentiles(writer["api"][method]["time-ms"],
+                                  statistics.timings);
+        }
       });
 
-  bot_.getApi().deleteWebhook();
-  Start();
+  if (testsuite_tasks_.IsEnabled()) {
+    testsuite_tasks_.RegisterTask(kForgetUpdatesTaskName, [this] {
+      std::lock_guard lock(seen_updates_mutex_);
+      seen_updates_.Invalidate();
+    });
+  }
+
+  RegisterHandlers();
+  // empty if updates are polled
+  const auto webhook_url =
+      config["webhook_url"].As<std::string>(std::string{});
+  if (!webhook_url.empty()) {
+    if (webhook_secret_.empty()) {
+      throw std::runtime_error(
+          "telegram_webhook_secret must be set in secdist to receive updates "
+          "by the webhook");
+    }
+    // Updates are pushed to any instance behind the url, there is no polling
+    telegram_client_
+        .SetWebhook(webhook_url, webhook_secret_, kWebhookMaxConnections)
+        .Get();
+  } else {
+    telegram_client_.DeleteWebhook().Get();
+    Start();
+  }
+}
+
+Component::~Component() {
+  if (testsuite_tasks_.IsEnabled()) {
+    testsuite_tasks_.UnregisterTask(kForgetUpdatesTaskName);
+  }
 }
 
 void Component::Start() {
@@ -141,22 +270,23 @@ void Component::Start() {
       });
 }
 
-void Component::OnStartCommand(TgBot::Message::Ptr message) {
+void Component::OnStartCommand(const TelegramMessage& message) {
   ++metrics_.received_commands;
-  SendMessage(models::ChatId{message->chat->id}, "Hi!");
+  SendMessage(models::ChatId{message.chat_id}, "Hi!");
 }
 
-void Component::OnChatIdCommand(TgBot::Message::Ptr message) {
+void Component::OnChatIdCommand(const TelegramMessage& message) {
   ++metrics_.received_commands;
-  SendMessage(models::ChatId{message->chat->id},
-              fmt::format("Your chat id is {}", message->chat->id));
+  SendMessage(models::ChatId{message.chat_id},
+              fmt::format("Your chat id is {}", message.chat_id));
 }
 
-void Component::OnNextBirthdaysCommand(TgBot::Message::Ptr message) {
+void Component::OnNextBirthdaysCommand(const TelegramMessage& message) {
   ++metrics_.received_commands;
 
-  const models::ChatId chat_id{message->chat->id};
-  auto response = GetNextBirthdaysMessage(chat_id, *postgres_);
+  const models::ChatId chat_id{message.chat_id};
+  auto response = GetNextBirthdaysMessage(
+      FindCachedUser(chat_id), default_timezone_, *postgres_);
   if (response.keyboard.has_value()) {
     SendMessageWithKeyboard(chat_id, response.text, *response.keyboard);
   } else {
@@ -164,19 +294,19 @@ void Component::OnNextBirthdaysCommand(TgBot::Message::Ptr message) {
   }
 }
 
-void Component::OnAddBirthdayCommand(TgBot::Message::Ptr message) {
+void Component::OnAddBirthdayCommand(const TelegramMessage& message) {
   ++metrics_.received_commands;
 
-  const models::ChatId chat_id{message->chat->id};
-  const auto user_id = db::FindUser(chat_id, *postgres_);
-  if (!user_id.has_value()) {
+  const models::ChatId chat_id{message.chat_id};
+  const auto user = FindCachedUser(chat_id);
+  if (!user.has_value()) {
     SendMessage(chat_id, "Not registered yet, try to /register");
     return;
   }
 
   std::regex re(R"(^/add_birthday[^\s]*\s+(\d{2})\.(\d{2})(.(\d{4}))?\s+(.*))");
   std::smatch match;
-  if (!std::regex_match(message->text, match, re)) {
+  if (!std::regex_match(message.text, match, re)) {
     SendMessage(chat_id, "Usage: /add_birthday DD.MM[.YYYY] Person Name");
     return;
   }
@@ -200,7 +330,22 @@ void Component::OnAddBirthdayCommand(TgBot::Message::Ptr message) {
     return;
   }
 
-  db::InsertBirthday(m, d, y, person, *user_id, *postgres_);
+  // a timezone changed by another replica a moment ago is covered by the
+  // forgotten birthday search distance
+  const auto inserted =
+      ChangeAsUser(chat_id, *user, [&](const models::User& actual_user) {
+        if (!db::InsertBirthday(m, d, y, person, actual_user.id,
+                                GetLocalDay(actual_user, default_timezone_),
+                                *postgres_)) {
+          return false;
+        }
+        birthdays_changed_channel_.SendEvent(actual_user.id);
+        return true;
+      });
+  if (!inserted.value_or(false)) {
+    SendMessage(chat_id, "Not registered yet, try to /register");
+    return;
+  }
   SendMessage(chat_id, fmt::format("Inserted the birthday of {} on {:02}.{:02}",
                                    person, d, m));
 }
@@ -235,14 +380,24 @@ void Component::OnDeleteBirthdayButton(const models::ChatId chat_id,
     return;
   }
 
-  const auto user_id = db::FindUser(chat_id, *postgres_);
-  if (!user_id.has_value()) {
+  const auto user = FindCachedUser(chat_id);
+  if (!user.has_value()) {
     LOG_WARNING() << "Got button from missing user";
     UpdateMessageWithKeyboard(chat_id, message_id, "Canceled", {});
     return;
   }
 
-  if (!db::IsOwnerOfBirthday(*user_id, *button_data.birthday_id, *postgres_)) {
+  const auto is_owner =
+      ChangeAsUser(chat_id, *user, [&](const models::User& actual_user) {
+        return db::IsOwnerOfBirthday(actual_user.id, *button_data.birthday_id,
+                                     *postgres_);
+      });
+  if (!is_owner.has_value()) {
+    LOG_WARNING() << "Got button from missing user";
+    UpdateMessageWithKeyboard(chat_id, message_id, "Canceled", {});
+    return;
+  }
+  if (!*is_owner) {
     LOG_WARNING() << "Tried to delete another user's data";
     UpdateMessageWithKeyboard(chat_id, message_id, "Canceled", {});
     return;
@@ -258,58 +413,146 @@ void Component::OnCancelButton(const models::ChatId chat_id,
   UpdateMessageWithKeyboard(chat_id, message_id, "Canceled", {});
 }
 
-void Component::OnRegisterCommand(TgBot::Message::Ptr message) {
+void Component::OnRegisterCommand(const TelegramMessage& message) {
   ++metrics_.received_commands;
 
-  const models::ChatId chat_id{message->chat->id};
-  const auto user_id = db::FindUser(chat_id, *postgres_);
-  if (user_id.has_value()) {
+  const models::ChatId chat_id{message.chat_id};
+  if (!db::InsertUser(chat_id, *postgres_)) {
     SendMessage(chat_id, "Already registered");
     return;
   }
-
-  db::InsertUser(chat_id, *postgres_);
+  users_cache_->InvalidateByKey(chat_id);
   SendMessage(chat_id,
               "Done. Note that all your personal data will be stored in plain "
               "text. I promise not to look :)");
 }
 
-void Component::OnUnregisterCommand(TgBot::Message::Ptr message) {
+void Component::OnUnregisterCommand(const TelegramMessage& message) {
   ++metrics_.received_commands;
 
-  const models::ChatId chat_id{message->chat->id};
-  const auto user_id = db::FindUser(chat_id, *postgres_);
-  if (!user_id.has_value()) {
+  const models::ChatId chat_id{message.chat_id};
+  const auto user = FindCachedUser(chat_id);
+  const auto deleted =
+      user.has_value()
+          ? ChangeAsUser(chat_id, *user,
+                         [&](const models::User& actual_user) {
+                           db::DeleteAllBirthdays(actual_user.id, *postgres_);
+                           return db::DeleteUser(actual_user.id, *postgres_);
+                         })
+          : std::nullopt;
+  users_cache_->InvalidateByKey(chat_id);
+  if (!deleted.value_or(false)) {
     SendMessage(chat_id, "You are not registered");
     return;
   }
 
-  db::DeleteAllBirthdays(*user_id, *postgres_);
-  db::DeleteUser(*user_id, *postgres_);
-
   SendMessage(chat_id, "Deleted all your birthdays and forgot about you");
 }
 
-void Component::OnCallbackQuery(const TgBot::CallbackQuery::Ptr callback) {
+void Component::OnTimezoneCommand(const TelegramMessage& message) {
+  ++metrics_.received_commands;
+
+  const models::ChatId chat_id{message.chat_id};
+  const auto user = FindCachedUser(chat_id);
+  if (!user.has_value()) {
+    SendMessage(chat_id, "Not registered yet, try to /register");
+    return;
+  }
+
+  std::regex re(R"(^/timezone[^\s]*\s+([^\s]+)\s*$)");
+  std::smatch match;
+  if (!std::regex_match(message.text, match, re)) {
+    SendMessage(chat_id, "Usage: /timezone Area/City, e.g. Europe/Moscow");
+    return;
+  }
+
+  const std::string timezone = match[1];
+  cctz::time_zone parsed_timezone;
+  if (!cctz::load_time_zone(timezone, &parsed_timezone)) {
+    SendMessage(chat_id, "Unknown timezone");
+    return;
+  }
+
+  const auto updated =
+      ChangeAsUser(chat_id, *user, [&](const models::User& actual_user) {
+        if (!db::UpdateTimezone(actual_user.id, timezone, *postgres_)) {
+          return false;
+        }
+        birthdays_changed_channel_.SendEvent(actual_user.id);
+        return true;
+      });
+  users_cache_->InvalidateByKey(chat_id);
+  if (!updated.value_or(false)) {
+    SendMessage(chat_id, "Not registered yet, try to /register");
+    return;
+  }
+  SendMessage(chat_id, fmt::format("Timezone is set to {}", timezone));
+}
+
+void Component::OnNotificationTimeCommand(const TelegramMessage& message) {
+  ++metrics_.received_commands;
+
+  const models::ChatId chat_id{message.chat_id};
+  const auto user = FindCachedUser(chat_id);
+  if (!user.has_value()) {
+    SendMessage(chat_id, "Not registered yet, try to /register");
+    return;
+  }
+
+  std::regex re(R"(^/notification_time[^\s]*\s+(\d{2}):(\d{2})\s*$)");
+  std::smatch match;
+  if (!std::regex_match(message.text, match, re)) {
+    SendMessage(chat_id, "Usage: /notification_time HH:MM");
+    return;
+  }
+
+  const int hours = std::stoi(match[1]);
+  const int minutes = std::stoi(match[2]);
+  if (hours > 23 || minutes > 59) {
+    SendMessage(chat_id, "Invalid time");
+    return;
+  }
+
+  const auto notification_time = fmt::format("{:02}:{:02}", hours, minutes);
+  const auto updated =
+      ChangeAsUser(chat_id, *user, [&](const models::User& actual_user) {
+        if (!db::UpdateNotificationTime(actual_user.id, notification_time,
+                                        *postgres_)) {
+          return false;
+        }
+        birthdays_changed_channel_.SendEvent(actual_user.id);
+        return true;
+      });
+  users_cache_->InvalidateByKey(chat_id);
+  if (!updated.value_or(false)) {
+    SendMessage(chat_id, "Not registered yet, try to /register");
+    return;
+  }
+  SendMessage(chat_id,
+              fmt::format("Notification time is set to {}", notification_time));
+}
+
+void Component::OnCallbackQuery(const TelegramCallbackQuery& callback) {
   ++metrics_.received_callbacks;
 
-  if (callback->message) {
-    const models::ChatId chat_id{callback->message->chat->id};
-    if (!callback->data.empty()) {
+  // the answer is awaited after the button is handled
+  auto answer = telegram_client_.AnswerCallbackQuery(callback.id);
+  if (callback.message.has_value()) {
+    const models::ChatId chat_id{callback.message->chat_id};
+    const auto message_id = callback.message->message_id;
+    if (!callback.data.empty()) {
       try {
         const auto button_data =
-            models::ButtonData::FromBase64Serialized(callback->data);
+            models::ButtonData::FromBase64Serialized(callback.data);
         switch (button_data.type) {
           case models::ButtonType::kEditBirthday:
-            OnEditBirthdayButton(chat_id, callback->message->messageId,
-                                 button_data);
+            OnEditBirthdayButton(chat_id, message_id, button_data);
             break;
           case models::ButtonType::kDeleteBirthday:
-            OnDeleteBirthdayButton(chat_id, callback->message->messageId,
-                                   button_data);
+            OnDeleteBirthdayButton(chat_id, message_id, button_data);
             break;
           case models::ButtonType::kCancel:
-            OnCancelButton(chat_id, callback->message->messageId);
+            OnCancelButton(chat_id, message_id);
             break;
         }
       } catch (const std::exception& exc) {
@@ -321,67 +564,208 @@ void Component::OnCallbackQuery(const TgBot::CallbackQuery::Ptr callback) {
   } else {
     LOG_INFO() << "No message in callback, skip";
   }
-  bot_.getApi().answerCallbackQuery(callback->id);
+  answer.Get();
 }
 
 void Component::RegisterCommand(
     const std::string& command,
-    void (Component::*const handler)(TgBot::Message::Ptr)) {
-  bot_commands_.insert("/" + command);
-  bot_.getEvents().onCommand(command,
-                             std::bind(handler, this, std::placeholders::_1));
+    void (Component::*const handler)(const TelegramMessage&)) {
+  command_handlers_.emplace(command, handler);
 }
 
-void Component::Run() {
-  try {
-    TgBot::TgLongPoll long_poll(bot_, 100, 1);
-
-    RegisterCommand("add_birthday", &Component::OnAddBirthdayCommand);
-    RegisterCommand("chat_id", &Component::OnChatIdCommand);
-    RegisterCommand("next_birthdays", &Component::OnNextBirthdaysCommand);
-    RegisterCommand("register", &Component::OnRegisterCommand);
-    RegisterCommand("start", &Component::OnStartCommand);
-    RegisterCommand("unregister", &Component::OnUnregisterCommand);
-
-    bot_.getEvents().onCallbackQuery(
-        [this](const TgBot::CallbackQuery::Ptr callback) {
-          OnCallbackQuery(callback);
+void Component::RegisterHandlers() {
+  RegisterCommand("add_birthday", &Component::OnAddBirthdayCommand);
+  RegisterCommand("chat_id", &Component::OnChatIdCommand);
+  RegisterCommand("next_birthdays", &Component::OnNextBirthdaysCommand);
+  RegisterCommand("notification_time", &Component::OnNotificationTimeCommand);
+  RegisterCommand("register", &Component::OnRegisterCommand);
+  RegisterCommand("start", &Component::OnStartCommand);
+  RegisterCommand("timezone", &Component::OnTimezoneCommand);
+  RegisterCommand("unregister", &Component::OnUnregisterCommand);
+}
+
+void Component::DispatchUpdate(const TelegramUpdate& update) {
+  if (update.message.has_value()) {
+    const auto command = GetCommand(update.message->text);
+    if (!command.has_value()) {
+      return;
+    }
+    const auto it = command_handlers_.find(std::string{*command});
+    if (it == command_handlers_.end()) {
+      LOG_INFO() << "Unknown command " << *command << ", skip";
+      return;
+    }
+    update_dispatcher_.Dispatch(
+        models::ChatId{update.message->chat_id},
+        [this, handler = it->second, message = *update.message] {
+          (this->*handler)(message);
         });
+  } else if (update.callback_query.has_value()) {
+    // callbacks of inline messages come without a message, they are ordered
+    // with the updates of their sender
+    const auto& callback = *update.callback_query;
+    const models::ChatId chat_id{callback.message.has_value()
+                                     ? callback.message->chat_id
+                                     : callback.from_id};
+    update_dispatcher_.Dispatch(
+        chat_id, [this, callback] { OnCallbackQuery(callback); });
+  }
+}
 
-    while (!userver::engine::current_task::ShouldCancel()) {
-      try {
-        LOG_INFO() << "Long poll started";
-        long_poll.start();
-        LOG_INFO() << "Long poll finished";
-      } catch (std::exception& e) {
-        LOG_ERROR() << "error: " << e;
+bool Component::MarkUpdateSeen(const int32_t update_id) {
+  std::lock_guard lock(seen_updates_mutex_);
+  if (seen_updates_.Has(update_id)) {
+    return false;
+  }
+  seen_updates_.Put(update_id);
+  return true;
+}
+
+void Component::Run() {
+  // updates before the offset are confirmed and not sent again
+  int32_t offset = 0;
+  while (!userver::engine::current_task::ShouldCancel()) {
+    try {
+      const auto start = std::chrono::steady_clock::now();
+      const auto updates =
+          telegram_client_
+              .GetUpdates(offset, long_poll_settings_.limit,
+                          long_poll_settings_.timeout,
+                          long_poll_settings_.allowed_updates)
+              .Get();
+      ++metrics_.polls;
+      metrics_.polled_updates += updates.size();
+      metrics_.poll_timings.GetCurrentCounter().Account(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+      metrics_.poll_batch_sizes.GetCurrentCounter().Account(updates.size());
+
+      for (const auto& update : updates) {
+        offset = std::max(offset, update.update_id + 1);
+        // a poll whose response was lost returns its updates again
+        if (!MarkUpdateSeen(update.update_id)) {
+          LOG_INFO() << "Update " << update.update_id
+                     << " is handled already, skip";
+          continue;
+        }
+        // handlers are run by the dispatcher, this waits only if it is full
+        DispatchUpdate(update);
       }
+    } catch (const std::exception& exc) {
+      ++metrics_.poll_errors;
+      LOG_ERROR() << "Failed to poll updates: " << exc;
+      userver::engine::InterruptibleSleepFor(kPollRetryDelay);
+    }
+  }
+}
+
+std::optional<models::User> Component::FindCachedUser(
+    const models::ChatId chat_id) {
+  auto user = users_cache_->Get(chat_id);
+  if (!user.has_value()) {
+    users_cache_->InvalidateByKey(chat_id);
+  }
+  return user;
+}
+
+std::optional<bool> Component::ChangeAsUser(
+    const models::ChatId chat_id, const models::User& cached_user,
+    const std::function<bool(const models::User&)>& change) {
+  std::optional<models::User> user = cached_user;
+  if (!change(*user)) {
+    users_cache_->InvalidateByKey(chat_id);
+    user = FindCachedUser(chat_id);
+    if (!user.has_value()) {
+      return std::nullopt;
+    }
+    // the cached user was the actual one, the change failed for its own
+    // reasons
+    if (user->id == cached_user.id) {
+      return false;
     }
+    return change(*user);
+  }
+  return true;
+}
+
+bool Component::IsValidWebhookSecret(const std::string_view secret) const {
+  return !webhook_secret_.empty() &&
+         userver::crypto::algorithm::AreStringsEqualConstTime(
+             secret, webhook_secret_);
+}
+
+void Component::HandleUpdate(const std::string& update_json) {
+  ++metrics_.received_webhook_updates;
+
+  const auto update =
+      userver::formats::json::FromString(update_json).As<TelegramUpdate>();
+  if (!MarkUpdateSeen(update.update_id)) {
+    LOG_INFO() << "Update " << update.update_id << " is handled already, skip";
+    return;
+  }
+  try {
+    DispatchUpdate(update);
   } catch (const std::exception& exc) {
-    LOG_ERROR() << "Unexpected exception " << exc;
-    throw;
+    // as in long polling, a failed update is not redelivered
+    LOG_ERROR() << "Failed to handle update " << update.update_id << ": "
+                << exc;
   }
 }
 
+userver::concurrent::AsyncEventChannel<models::UserId>&
+Component::GetBirthdaysChangedChannel() {
+  return birthdays_changed_channel_;
+}
+
 void Component::SendMessage(const models::ChatId chat_id,
                             const std::string& text) {
-  SendMessageImpl(chat_id, text, std::nullopt);
+  SendMessageImpl(chat_id, text, std::nullopt, SendPriority::kInteractive);
+}
+
+void Component::SendBulkMessage(const models::ChatId chat_id,
+                                const std::string& text) {
+  SendMessageImpl(chat_id, text, std::nullopt, SendPriority::kBulk);
 }
 
 void Component::SendMessageWithKeyboard(
     const models::ChatId chat_id, const std::string& text,
     const std::vector<std::vector<models::Button>>& button_rows) {
-  SendMessageImpl(chat_id, text, button_rows);
+  SendMessageImpl(chat_id, text, button_rows, SendPriority::kInteractive);
+}
+
+template <typename Request>
+void Component::CallWithFloodControl(const models::ChatId chat_id,
+                                     const SendPriority priority,
+                                     const Request& request) {
+  for (int attempt = 1;; ++attempt) {
+    send_scheduler_.Acquire(chat_id, priority);
+    try {
+      request();
+      return;
+    } catch (const TooManyRequestsError& exc) {
+      ++metrics_.throttled_requests;
+      LOG_WARNING() << "Throttled by telegram, attempt " << attempt << ": "
+                    << exc;
+      send_scheduler_.PauseFor(exc.GetRetryAfter());
+      if (attempt >= kMaxThrottledAttempts) {
+        throw;
+      }
+    }
+  }
 }
 
 void Component::SendMessageImpl(
     const models::ChatId chat_id, const std::string& text,
-    std::optional<std::vector<std::vector<models::Button>>> button_rows) {
+    std::optional<std::vector<std::vector<models::Button>>> button_rows,
+    const SendPriority priority) {
   ++metrics_.sent_messages;
 
-  bot_.getApi().sendMessage(
-      chat_id.GetUnderlying(), text, false /*disableWebPagePreview*/,
-      0 /*replyToMessageId*/, MakeReplyMarkup(std::move(button_rows)));
+  const auto reply_markup = MakeReplyMarkup(std::move(button_rows));
+  CallWithFloodControl(chat_id, priority, [&] {
+    telegram_client_.SendMessage(chat_id.GetUnderlying(), text, reply_markup)
+        .Get();
+  });
 }
 
 void Component::UpdateMessageWithKeyboard(
@@ -389,10 +773,13 @@ void Component::UpdateMessageWithKeyboard(
     const std::vector<std::vector<models::Button>>& button_rows) {
   ++metrics_.updated_messages;
 
-  bot_.getApi().editMessageText(text, chat_id.GetUnderlying(), message_id,
-                                "" /* inlineMessageId */, "" /* parseMode */,
-                                false /* disableWebPagePreview */,
-                                MakeReplyMarkup(button_rows));
+  const auto reply_markup = MakeReplyMarkup(button_rows);
+  CallWithFloodControl(chat_id, SendPriority::kInteractive, [&] {
+    telegram_client_
+        .EditMessageText(chat_id.GetUnderlying(), message_id, text,
+                         reply_markup)
+        .Get();
+  });
 }
 
 }  // namespace telegram_bot::components::bot::impl
@@ -1,28 +1,69 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include <cctz/time_zone.h>
+
+#include <userver/cache/lru_set.hpp>
 #include <userver/components/component_fwd.hpp>
+#include <userver/concurrent/async_event_channel.hpp>
+#include <userver/engine/mutex.hpp>
 #include <userver/engine/task/task_with_result.hpp>
 #include <userver/storages/postgres/cluster.hpp>
+#include <userver/testsuite/tasks.hpp>
 #include <userver/utils/statistics/entry.hpp>
+#include <userver/utils/statistics/percentile.hpp>
+#include <userver/utils/statistics/recentperiod.hpp>
 
-#include <tgbot/tgbot.h>
-
-#include <components/bot/impl/http_client.hpp>
+#include <components/users_cache.hpp>
+#include <components/bot/impl/send_scheduler.hpp>
+#include <components/bot/impl/telegram_client.hpp>
+#include <components/bot/impl/telegram_types.hpp>
+#include <components/bot/impl/update_dispatcher.hpp>
 #include <models/button.hpp>
 
 namespace telegram_bot::components::bot::impl {
 
+struct LongPollSettings {
+  // updates per getUpdates, telegram caps it at 100
+  int32_t limit{100};
+  // Time telegram holds a request without updates. It answers as soon as an
+  // update arrives, so a long timeout costs a request per timeout when idle
+  // and adds no latency when busy.
+  std::chrono::seconds timeout{50};
+  // empty for all the update types
+  std::vector<std::string> allowed_updates;
+};
+
 struct Metrics {
+  std::atomic<int64_t> polls{};
+  std::atomic<int64_t> poll_errors{};
+  std::atomic<int64_t> polled_updates{};
+  // milliseconds
+  userver::utils::statistics::RecentPeriod<
+      userver::utils::statistics::Percentile<2048>,
+      userver::utils::statistics::Percentile<2048>>
+      poll_timings;
+  // updates per getUpdates, telegram returns at most 100
+  userver::utils::statistics::RecentPeriod<
+      userver::utils::statistics::Percentile<101>,
+      userver::utils::statistics::Percentile<101>>
+      poll_batch_sizes;
   std::atomic<int64_t> received_commands{};
   std::atomic<int64_t> received_callbacks{};
+  std::atomic<int64_t> received_webhook_updates{};
   std::atomic<int64_t> sent_messages{};
   std::atomic<int64_t> updated_messages{};
+  std::atomic<int64_t> throttled_requests{};
 };
 
 class Component final {
@@ -30,9 +71,12 @@ class Component final {
   Component(const userver::components::ComponentConfig&,
             const userver::components::ComponentContext&);
 
+  ~Component();
+
   static constexpr const auto kName = "telegram-bot";
 
   void SendMessage(models::ChatId chat_id, const std::string& text);
+  void SendBulkMessage(models::ChatId chat_id, const std::string& text);
   void SendMessageWithKeyboard(
       models::ChatId chat_id, const std::string& text,
       const std::vector<std::vector<models::Button>>& button_rows);
@@ -40,38 +84,84 @@ class Component final {
       models::ChatId chat_id, int32_t message_id, const std::string& text,
       const std::vector<std::vector<models::Button>>& button_rows);
 
+  // Webhook requests are accepted only if the secret is set in secdist
+  bool IsValidWebhookSecret(std::string_view secret) const;
+  // Update pushed to the webhook, throws if the update is malformed. An
+  // update handled lately is skipped.
+  void HandleUpdate(const std::string& update_json);
+
+  userver::concurrent::AsyncEventChannel<models::UserId>&
+  GetBirthdaysChangedChannel();
+
  private:
-  TelegramApiHttpClient telegram_client_;
-  std::string telegram_token_;
-  std::string telegram_host_;
-  TgBot::Bot bot_;
+  TelegramClient telegram_client_;
+  // empty if updates are not accepted by the webhook
+  std::string webhook_secret_;
   userver::storages::postgres::ClusterPtr postgres_;
-  std::unordered_set<std::string> bot_commands_;
+  std::shared_ptr<UsersCache::CacheWrapper> users_cache_;
+  // by the command without the slash
+  std::unordered_map<std::string, void (Component::*)(const TelegramMessage&)>
+      command_handlers_;
+  SendScheduler send_scheduler_;
+  const LongPollSettings long_poll_settings_;
+  // for users which have not set their own
+  cctz::time_zone default_timezone_;
+  userver::concurrent::AsyncEventChannel<models::UserId>
+      birthdays_changed_channel_{"birthdays-changed"};
   Metrics metrics_;
+  // handlers of commands and callbacks run there
+  UpdateDispatcher update_dispatcher_;
+  // Ids of the updates handled lately, polled or pushed to the webhook.
+  // Telegram delivers an update again if it is not confirmed in time, so a
+  // command is not run twice.
+  userver::engine::Mutex seen_updates_mutex_;
+  userver::cache::LruSet<int32_t> seen_updates_;
+  userver::testsuite::TestsuiteTasks& testsuite_tasks_;
   userver::utils::statistics::Entry statistics_holder_;
   userver::engine::TaskWithResult<void> task_;
 
  private:
   void Start();
+  void RegisterHandlers();
   void Run();
   void SendMessageImpl(
       models::ChatId chat_id, const std::string& text,
-      std::optional<std::vector<std::vector<models::Button>>> button_rows);
+      std::optional<std::vector<std::vector<models::Button>>> button_rows,
+      SendPriority priority);
+  template <typename Request>
+  void CallWithFloodControl(models::ChatId chat_id, SendPriority priority,
+                            const Request& request);
   void RegisterCommand(const std::string& command,
-                       void (Component::*handler)(TgBot::Message::Ptr));
+                       void (Component::*handler)(const TelegramMessage&));
+  void DispatchUpdate(const TelegramUpdate& update);
+  // false if the update was handled lately
+  bool MarkUpdateSeen(int32_t update_id);
+  // The cache may miss changes of other replicas for the lifetime of its
+  // entries. Unregistered chats are not cached, so a registration made by
+  // another replica is seen at once.
+  std::optional<models::User> FindCachedUser(models::ChatId chat_id);
+  // Runs the change as the cached user. The user may have been deleted by
+  // another replica, so a change which fails is run once more as the user
+  // read from the database if that one is different. Returns std::nullopt if
+  // the chat is not registered.
+  std::optional<bool> ChangeAsUser(
+      models::ChatId chat_id, const models::User& cached_user,
+      const std::function<bool(const models::User&)>& change);
 
-  void OnStartCommand(TgBot::Message::Ptr message);
-  void OnChatIdCommand(TgBot::Message::Ptr message);
-  void OnNextBirthdaysCommand(TgBot::Message::Ptr message);
-  void OnAddBirthdayCommand(TgBot::Message::Ptr message);
+  void OnStartCommand(const TelegramMessage& message);
+  void OnChatIdCommand(const TelegramMessage& message);
+  void OnNextBirthdaysCommand(const TelegramMessage& message);
+  void OnAddBirthdayCommand(const TelegramMessage& message);
   void OnEditBirthdayButton(models::ChatId chat_id, int32_t message_id,
                             const models::ButtonData& button_data);
   void OnDeleteBirthdayButton(models::ChatId chat_id, int32_t message_id,
                               const models::ButtonData& button_data);
   void OnCancelButton(models::ChatId chat_id, int32_t message_id);
-  void OnRegisterCommand(TgBot::Message::Ptr message);
-  void OnUnregisterCommand(TgBot::Message::Ptr message);
-  void OnCallbackQuery(const TgBot::CallbackQuery::Ptr callback);
+  void OnRegisterCommand(const TelegramMessage& message);
+  void OnUnregisterCommand(const TelegramMessage& message);
+  void OnTimezoneCommand(const TelegramMessage& message);
+  void OnNotificationTimeCommand(const TelegramMessage& message);
+  void OnCallbackQuery(const TelegramCallbackQuery& callback);
 };
 
 }  // namespace telegram_bot::components::bot::impl
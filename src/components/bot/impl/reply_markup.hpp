@@ -3,14 +3,14 @@
 #include <optional>
 #include <vector>
 
-#include <tgbot/types/GenericReply.h>
+#include <userver/formats/json/value.hpp>
 
 #include <models/button.hpp>
 
 namespace telegram_bot::components::bot::impl {
 
-// may return nullptr
-TgBot::GenericReply::Ptr MakeReplyMarkup(
+// Inline keyboard markup, may return nullopt
+std::optional<userver::formats::json::Value> MakeReplyMarkup(
     std::optional<std::vector<std::vector<models::Button>>>&& keyboard);
 
 }  // namespace telegram_bot::components::bot::impl
@@ -0,0 +1,39 @@
+#include "reply_markup.hpp"
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+using Keyboard = std::vector<std::vector<telegram_bot::models::Button>>;
+
+// MakeReplyMarkup consumes the keyboard, so every iteration gets a keyboard
+// of its own built before the timing loop
+const benchmark::IterationCount kIterations = 10000;
+
+void BM_MakeReplyMarkup(benchmark::State& state) {
+  Keyboard keyboard;
+  for (int i = 0; i < state.range(0); ++i) {
+    keyboard.push_back({telegram_bot::models::Button{
+        "person" + std::to_string(i) + " on 15.03",
+        telegram_bot::models::ButtonType::kEditBirthday,
+        telegram_bot::models::ButtonContext::kNextBirthdays,
+        telegram_bot::models::BirthdayId{i}}});
+  }
+  std::vector<std::optional<Keyboard>> keyboards(state.max_iterations,
+                                                 keyboard);
+
+  auto it = keyboards.begin();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        telegram_bot::components::bot::impl::MakeReplyMarkup(
+            std::move(*it++)));
+  }
+}
+BENCHMARK(BM_MakeReplyMarkup)->Arg(1)->Arg(6)->Arg(50)->Iterations(kIterations);
+
+}  // namespace
@@ -0,0 +1,143 @@
+#include "send_scheduler.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+#include <userver/engine/sleep.hpp>
+#include <userver/engine/task/cancel.hpp>
+#include <userver/utils/assert.hpp>
+#include <userver/utils/scope_guard.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+namespace {
+
+// The least recently used bucket is evicted, at the global rate the other
+// chats take minutes to push it out, and by then it is full again, which is
+// the same as a missing one
+const std::size_t kMaxChatBuckets = 10000;
+
+std::atomic<std::size_t>& GetWaitingCounter(
+    std::atomic<std::size_t>& interactive, std::atomic<std::size_t>& bulk,
+    const SendPriority priority) {
+  return priority == SendPriority::kInteractive ? interactive : bulk;
+}
+
+}  // namespace
+
+TokenBucket::TokenBucket(const double tokens_per_second,
+                         const double max_tokens, const Clock::time_point now)
+    : tokens_per_second_{tokens_per_second},
+      max_tokens_{max_tokens},
+      tokens_{max_tokens},
+      last_refill_{now} {
+  UINVARIANT(tokens_per_second_ > 0, "Tokens rate must be positive");
+  UINVARIANT(max_tokens_ >= 1, "Bucket must hold at least one token");
+}
+
+void TokenBucket::Refill(const Clock::time_point now) {
+  if (now <= last_refill_) {
+    return;
+  }
+  const std::chrono::duration<double> elapsed = now - last_refill_;
+  tokens_ =
+      std::min(max_tokens_, tokens_ + elapsed.count() * tokens_per_second_);
+  last_refill_ = now;
+}
+
+TokenBucket::Clock::duration TokenBucket::GetTimeUntil(
+    const double count) const {
+  if (tokens_ >= count) {
+    return Clock::duration::zero();
+  }
+  const std::chrono::duration<double> wait{(count - tokens_) /
+                                           tokens_per_second_};
+  // rounding up, so that the tokens are there after the wait
+  return std::chrono::ceil<Clock::duration>(wait);
+}
+
+bool TokenBucket::IsFull() const { return tokens_ >= max_tokens_; }
+
+void TokenBucket::Take() {
+  UASSERT(tokens_ >= 1);
+  tokens_ -= 1;
+}
+
+SendScheduler::SendScheduler(const SendSchedulerSettings& settings)
+    : settings_{settings},
+      global_bucket_{settings.global_messages_per_second,
+                     settings.global_messages_per_second, Clock::now()},
+      chat_buckets_{kMaxChatBuckets} {}
+
+void SendScheduler::Acquire(const models::ChatId chat_id,
+                            const SendPriority priority) {
+  const auto start = Clock::now();
+  auto& waiting =
+      GetWaitingCounter(waiting_interactive_, waiting_bulk_, priority);
+  ++waiting;
+  userver::utils::ScopeGuard waiting_guard([&waiting] { --waiting; });
+
+  while (true) {
+    Clock::duration delay{};
+    {
+      std::lock_guard lock(mutex_);
+      delay = TryAcquire(chat_id, priority, Clock::now());
+    }
+    if (delay == Clock::duration::zero()) {
+      break;
+    }
+    userver::engine::InterruptibleSleepFor(delay);
+    userver::engine::current_task::CancellationPoint();
+  }
+
+  wait_timings_.GetCurrentCounter().Account(
+      std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                            start)
+          .count());
+}
+
+void SendScheduler::PauseFor(const std::chrono::seconds retry_after) {
+  std::lock_guard lock(mutex_);
+  paused_until_ = std::max(paused_until_, Clock::now() + retry_after);
+}
+
+std::size_t SendScheduler::GetQueueSize(const SendPriority priority) const {
+  return priority == SendPriority::kInteractive ? waiting_interactive_.load()
+                                                : waiting_bulk_.load();
+}
+
+const WaitTimings& SendScheduler::GetWaitTimings() const {
+  return wait_timings_;
+}
+
+SendScheduler::Clock::duration SendScheduler::TryAcquire(
+    const models::ChatId chat_id, const SendPriority priority,
+    const Clock::time_point now) {
+  if (now < paused_until_) {
+    return paused_until_ - now;
+  }
+
+  // Bulk messages leave a token for every queued interactive one
+  const double global_tokens_needed =
+      priority == SendPriority::kInteractive
+          ? 1
+          : std::min(1 + static_cast<double>(waiting_interactive_.load()),
+                     settings_.global_messages_per_second);
+  global_bucket_.Refill(now);
+  const auto global_delay = global_bucket_.GetTimeUntil(global_tokens_needed);
+
+  auto& chat_bucket = *chat_buckets_.Emplace(
+      chat_id, settings_.chat_messages_per_second,
+      settings_.chat_messages_burst, now);
+  chat_bucket.Refill(now);
+  const auto chat_delay = chat_bucket.GetTimeUntil(1);
+
+  const auto delay = std::max(global_delay, chat_delay);
+  if (delay == Clock::duration::zero()) {
+    global_bucket_.Take();
+    chat_bucket.Take();
+  }
+  return delay;
+}
+
+}  // namespace telegram_bot::components::bot::impl
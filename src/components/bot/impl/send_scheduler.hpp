@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include <userver/cache/lru_map.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/utils/statistics/percentile.hpp>
+#include <userver/utils/statistics/recentperiod.hpp>
+
+#include <models/user.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+enum class SendPriority {
+  // replies to user commands and callbacks
+  kInteractive,
+  // notifications, yield to interactive messages
+  kBulk,
+};
+
+class TokenBucket final {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  TokenBucket(double tokens_per_second, double max_tokens,
+              Clock::time_point now);
+
+  void Refill(Clock::time_point now);
+  // zero if `count` tokens are available already
+  Clock::duration GetTimeUntil(double count) const;
+  bool IsFull() const;
+  void Take();
+
+ private:
+  double tokens_per_second_;
+  double max_tokens_;
+  double tokens_;
+  Clock::time_point last_refill_;
+};
+
+struct SendSchedulerSettings {
+  double global_messages_per_second{30};
+  double chat_messages_per_second{1};
+  double chat_messages_burst{3};
+};
+
+using WaitTimings = userver::utils::statistics::RecentPeriod<
+    userver::utils::statistics::Percentile<2048>,
+    userver::utils::statistics::Percentile<2048>>;
+
+// Paces outgoing messages with a global token bucket and a token bucket per
+// chat, so that Telegram flood limits are not hit
+class SendScheduler final {
+ public:
+  explicit SendScheduler(const SendSchedulerSettings& settings);
+
+  // Blocks until a message to the chat may be sent
+  void Acquire(models::ChatId chat_id, SendPriority priority);
+
+  // Postpones all the sends, used on 429 responses
+  void PauseFor(std::chrono::seconds retry_after);
+
+  std::size_t GetQueueSize(SendPriority priority) const;
+  // wait time in milliseconds
+  const WaitTimings& GetWaitTimings() const;
+
+ private:
+  using Clock = TokenBucket::Clock;
+
+  const SendSchedulerSettings settings_;
+  userver::engine::Mutex mutex_;
+  TokenBucket global_bucket_;
+  userver::cache::LruMap<models::ChatId, TokenBucket> chat_buckets_;
+  Clock::time_point paused_until_;
+  std::atomic<std::size_t> waiting_interactive_{};
+  std::atomic<std::size_t> waiting_bulk_{};
+  WaitTimings wait_timings_;
+
+ private:
+  // returns zero if the message may be sent now
+  Clock::duration TryAcquire(models::ChatId chat_id, SendPriority priority,
+                             Clock::time_point now);
+};
+
+}  // namespace telegram_bot::components::bot::impl
@@ -0,0 +1,70 @@
+#include "send_scheduler.hpp"
+
+#include <userver/utest/utest.hpp>
+
+using telegram_bot::components::bot::impl::SendPriority;
+using telegram_bot::components::bot::impl::SendScheduler;
+using telegram_bot::components::bot::impl::TokenBucket;
+
+namespace {
+
+const TokenBucket::Clock::time_point kStart{};
+
+}  // namespace
+
+TEST(TokenBucket, StartsFull) {
+  TokenBucket bucket{2, 3, kStart};
+  EXPECT_TRUE(bucket.IsFull());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(bucket.GetTimeUntil(1), TokenBucket::Clock::duration::zero());
+    bucket.Take();
+  }
+  EXPECT_EQ(bucket.GetTimeUntil(1), std::chrono::milliseconds(500));
+  EXPECT_EQ(bucket.GetTimeUntil(2), std::chrono::seconds(1));
+}
+
+TEST(TokenBucket, Refill) {
+  TokenBucket bucket{2, 3, kStart};
+  for (int i = 0; i < 3; ++i) {
+    bucket.Take();
+  }
+
+  bucket.Refill(kStart + std::chrono::milliseconds(250));
+  EXPECT_EQ(bucket.GetTimeUntil(1), std::chrono::milliseconds(250));
+
+  bucket.Refill(kStart + std::chrono::milliseconds(500));
+  EXPECT_EQ(bucket.GetTimeUntil(1), TokenBucket::Clock::duration::zero());
+  EXPECT_FALSE(bucket.IsFull());
+
+  bucket.Refill(kStart + std::chrono::seconds(10));
+  EXPECT_TRUE(bucket.IsFull());
+  EXPECT_EQ(bucket.GetTimeUntil(3), TokenBucket::Clock::duration::zero());
+  EXPECT_EQ(bucket.GetTimeUntil(4), std::chrono::milliseconds(500));
+}
+
+UTEST(SendScheduler, PerChatLimit) {
+  SendScheduler scheduler{{.global_messages_per_second = 1000,
+                           .chat_messages_per_second = 1000,
+                           .chat_messages_burst = 2}};
+  const telegram_bot::models::ChatId chat_id{1};
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 4; ++i) {
+    scheduler.Acquire(chat_id, SendPriority::kBulk);
+  }
+  // two messages are sent at once, the others wait for 1ms each
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(2));
+  EXPECT_EQ(scheduler.GetQueueSize(SendPriority::kBulk), 0);
+  EXPECT_EQ(scheduler.GetQueueSize(SendPriority::kInteractive), 0);
+}
+
+UTEST(SendScheduler, Pause) {
+  SendScheduler scheduler{{}};
+  const telegram_bot::models::ChatId chat_id{1};
+
+  scheduler.PauseFor(std::chrono::seconds(1));
+  const auto start = std::chrono::steady_clock::now();
+  scheduler.Acquire(chat_id, SendPriority::kInteractive);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
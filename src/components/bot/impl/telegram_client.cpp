@@ -0,0 +1,205 @@
+#include "telegram_client.hpp"
+
+#include <fmt/format.h>
+
+#include <userver/formats/json/inline.hpp>
+#include <userver/formats/json/serialize.hpp>
+#include <userver/formats/json/value_builder.hpp>
+#include <userver/formats/serialize/common_containers.hpp>
+#include <userver/http/common_headers.hpp>
+#include <userver/logging/log.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+namespace {
+
+const std::chrono::seconds kDefaultRetryAfter{1};
+
+const std::string kGetUpdates = "getUpdates";
+const std::string kSendMessage = "sendMessage";
+const std::string kEditMessageText = "editMessageText";
+const std::string kAnswerCallbackQuery = "answerCallbackQuery";
+const std::string kSetWebhook = "setWebhook";
+const std::string kDeleteWebhook = "deleteWebhook";
+
+const std::vector<std::string> kMethods{
+    kGetUpdates, kSendMessage, kEditMessageText,
+    kAnswerCallbackQuery, kSetWebhook, kDeleteWebhook,
+};
+
+std::chrono::seconds ParseRetryAfter(const std::string& body) {
+  try {
+    const auto json = userver::formats::json::FromString(body);
+    return std::chrono::seconds{json["parameters"]["retry_after"].As<int>(
+        kDefaultRetryAfter.count())};
+  } catch (const std::exception& exc) {
+    LOG_WARNING() << "Failed to parse retry_after: " << exc;
+    return kDefaultRetryAfter;
+  }
+}
+
+userver::formats::json::Value ParseTelegramResponse(
+    const userver::clients::http::Response& response) {
+  const auto status = response.status_code();
+  if (status == userver::clients::http::Status::TooManyRequests) {
+    throw TooManyRequestsError{ParseRetryAfter(response.body())};
+  }
+  if (static_cast<int>(status) >= 500) {
+    // proxies answer with html there
+    response.raise_for_status();
+  }
+
+  const auto json = userver::formats::json::FromString(response.body());
+  if (!json["ok"].As<bool>(false)) {
+    throw TelegramApiError{
+        json["error_code"].As<int>(static_cast<int>(status)),
+        json["description"].As<std::string>(std::string{})};
+  }
+  return json["result"];
+}
+
+}  // namespace
+
+TooManyRequestsError::TooManyRequestsError(
+    const std::chrono::seconds retry_after)
+    : std::runtime_error(fmt::format("Too many requests, retry after {}s",
+                                     retry_after.count())),
+      retry_after_{retry_after} {}
+
+std::chrono::seconds TooManyRequestsError::GetRetryAfter() const {
+  return retry_after_;
+}
+
+TelegramApiError::TelegramApiError(const int error_code,
+                                   const std::string& description)
+    : std::runtime_error(
+          fmt::format("Telegram error {}: {}", error_code, description)),
+      error_code_{error_code} {}
+
+int TelegramApiError::GetErrorCode() const { return error_code_; }
+
+userver::formats::json::Value WaitForTelegramResult(
+    userver::clients::http::ResponseFuture& future,
+    const std::chrono::steady_clock::time_point start,
+    TelegramMethodStatistics& statistics) {
+  const auto account_time = [&] {
+    statistics.timings.GetCurrentCounter().Account(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+  };
+  try {
+    auto result = ParseTelegramResponse(*future.Get());
+    account_time();
+    return result;
+  } catch (const std::exception&) {
+    ++statistics.errors;
+    account_time();
+    throw;
+  }
+}
+
+TelegramClient::TelegramClient(userver::clients::http::Client& http_client,
+                               const std::string& host,
+                               const std::string& token,
+                               const TelegramClientSettings& settings)
+    : http_client_{http_client}, use_http2_{settings.use_http2} {
+  for (const auto& method : kMethods) {
+    const auto it = settings.methods.find(method);
+    methods_.emplace(
+        method,
+        Method{fmt::format("{}/bot{}/{}", host, token, method),
+               it == settings.methods.end() ? TelegramMethodSettings{}
+                                            : it->second});
+    statistics_.try_emplace(method);
+  }
+}
+
+TelegramCall<std::vector<TelegramUpdate>> TelegramClient::GetUpdates(
+    const int32_t offset, const int32_t limit,
+    const std::chrono::seconds timeout,
+    const std::vector<std::string>& allowed_updates) const {
+  userver::formats::json::ValueBuilder body;
+  body["offset"] = offset;
+  body["limit"] = limit;
+  body["timeout"] = static_cast<int64_t>(timeout.count());
+  if (!allowed_updates.empty()) {
+    body["allowed_updates"] = allowed_updates;
+  }
+  // telegram holds getUpdates for up to its timeout argument
+  return Call<std::vector<TelegramUpdate>>(kGetUpdates, body.ExtractValue(),
+                                           timeout);
+}
+
+TelegramCall<TelegramMessage> TelegramClient::SendMessage(
+    const int64_t chat_id, const std::string& text,
+    const std::optional<userver::formats::json::Value>& reply_markup) const {
+  userver::formats::json::ValueBuilder body;
+  body["chat_id"] = chat_id;
+  body["text"] = text;
+  if (reply_markup.has_value()) {
+    body["reply_markup"] = *reply_markup;
+  }
+  return Call<TelegramMessage>(kSendMessage, body.ExtractValue());
+}
+
+TelegramCall<TelegramMessage> TelegramClient::EditMessageText(
+    const int64_t chat_id, const int32_t message_id, const std::string& text,
+    const std::optional<userver::formats::json::Value>& reply_markup) const {
+  userver::formats::json::ValueBuilder body;
+  body["chat_id"] = chat_id;
+  body["message_id"] = message_id;
+  body["text"] = text;
+  if (reply_markup.has_value()) {
+    body["reply_markup"] = *reply_markup;
+  }
+  return Call<TelegramMessage>(kEditMessageText, body.ExtractValue());
+}
+
+TelegramCall<void> TelegramClient::AnswerCallbackQuery(
+    const std::string& callback_query_id) const {
+  userver::formats::json::ValueBuilder body;
+  body["callback_query_id"] = callback_query_id;
+  return Call<void>(kAnswerCallbackQuery, body.ExtractValue());
+}
+
+TelegramCall<void> TelegramClient::SetWebhook(
+    const std::string& url, const std::string& secret_token,
+    const int32_t max_connections) const {
+  userver::formats::json::ValueBuilder body;
+  body["url"] = url;
+  body["secret_token"] = secret_token;
+  body["max_connections"] = max_connections;
+  return Call<void>(kSetWebhook, body.ExtractValue());
+}
+
+TelegramCall<void> TelegramClient::DeleteWebhook() const {
+  return Call<void>(kDeleteWebhook, userver::formats::json::MakeObject());
+}
+
+const std::unordered_map<std::string, TelegramMethodStatistics>&
+TelegramClient::GetStatistics() const {
+  return statistics_;
+}
+
+template <typename Result>
+TelegramCall<Result> TelegramClient::Call(
+    const std::string& method, const userver::formats::json::Value& body,
+    const std::chrono::milliseconds extra_timeout) const {
+  const auto& [url, settings] = methods_.at(method);
+  auto request =
+      http_client_.CreateRequest()
+          .post(url, userver::formats::json::ToString(body))
+          .headers({{userver::http::headers::kContentType,
+                     "application/json"}})
+          .timeout(settings.timeout + extra_timeout)
+          .retry(settings.attempts);
+  if (use_http2_) {
+    request.http_version(userver::clients::http::HttpVersion::k2Tls);
+  }
+  LOG_DEBUG() << "Request: " << method;
+
+  return {request.async_perform(), statistics_.at(method)};
+}
+
+}  // namespace telegram_bot::components::bot::impl
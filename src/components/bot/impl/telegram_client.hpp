@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <userver/clients/http/client.hpp>
+#include <userver/clients/http/response_future.hpp>
+#include <userver/formats/json/value.hpp>
+#include <userver/formats/parse/common_containers.hpp>
+#include <userver/utils/statistics/percentile.hpp>
+#include <userver/utils/statistics/recentperiod.hpp>
+
+#include <components/bot/impl/telegram_types.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+// Telegram flood control response
+class TooManyRequestsError final : public std::runtime_error {
+ public:
+  explicit TooManyRequestsError(std::chrono::seconds retry_after);
+
+  std::chrono::seconds GetRetryAfter() const;
+
+ private:
+  std::chrono::seconds retry_after_;
+};
+
+// Response with "ok": false
+class TelegramApiError final : public std::runtime_error {
+ public:
+  TelegramApiError(int error_code, const std::string& description);
+
+  int GetErrorCode() const;
+
+ private:
+  int error_code_;
+};
+
+struct TelegramMethodSettings {
+  std::chrono::milliseconds timeout{std::chrono::seconds{10}};
+  // attempts including the first one, calls which are not idempotent, e.g.
+  // sendMessage, may be duplicated by a retry
+  int attempts{1};
+};
+
+struct TelegramClientSettings {
+  // by the method name, the missing ones use the defaults
+  std::unordered_map<std::string, TelegramMethodSettings> methods;
+  // multiplexes the calls over one connection to the host
+  bool use_http2{false};
+};
+
+struct TelegramMethodStatistics {
+  // milliseconds, including the failed calls
+  userver::utils::statistics::RecentPeriod<
+      userver::utils::statistics::Percentile<2048>,
+      userver::utils::statistics::Percentile<2048>>
+      timings;
+  std::atomic<int64_t> errors{};
+};
+
+// Waits for the response and returns its result, throws TooManyRequestsError
+// and TelegramApiError
+userver::formats::json::Value WaitForTelegramResult(
+    userver::clients::http::ResponseFuture& future,
+    std::chrono::steady_clock::time_point start,
+    TelegramMethodStatistics& statistics);
+
+// Request in flight, Get waits for the response. Several calls may be started
+// before waiting for any of them.
+template <typename Result>
+class TelegramCall final {
+ public:
+  TelegramCall(userver::clients::http::ResponseFuture&& future,
+               TelegramMethodStatistics& statistics)
+      : future_(std::move(future)),
+        start_(std::chrono::steady_clock::now()),
+        statistics_(&statistics) {}
+
+  Result Get() {
+    const auto result = WaitForTelegramResult(future_, start_, *statistics_);
+    if constexpr (!std::is_void_v<Result>) {
+      return result.As<Result>();
+    }
+  }
+
+ private:
+  userver::clients::http::ResponseFuture future_;
+  std::chrono::steady_clock::time_point start_;
+  TelegramMethodStatistics* statistics_;
+};
+
+// Bot API over the userver HTTP client, only the methods the bot uses
+class TelegramClient final {
+ public:
+  TelegramClient(userver::clients::http::Client& http_client,
+                 const std::string& host, const std::string& token,
+                 const TelegramClientSettings& settings);
+
+  // timeout is the long poll one, empty allowed_updates are all the types
+  TelegramCall<std::vector<TelegramUpdate>> GetUpdates(
+      int32_t offset, int32_t limit, std::chrono::seconds timeout,
+      const std::vector<std::string>& allowed_updates) const;
+
+  TelegramCall<TelegramMessage> SendMessage(
+      int64_t chat_id, const std::string& text,
+      const std::optional<userver::formats::json::Value>& reply_markup) const;
+
+  TelegramCall<TelegramMessage> EditMessageText(
+      int64_t chat_id, int32_t message_id, const std::string& text,
+      const std::optional<userver::formats::json::Value>& reply_markup) const;
+
+  TelegramCall<void> AnswerCallbackQuery(
+      const std::string& callback_query_id) const;
+
+  TelegramCall<void> SetWebhook(
+      const std::string& url, const std::string& secret_token,
+      int32_t max_connections) const;
+
+  TelegramCall<void> DeleteWebhook() const;
+
+  // by the method name
+  const std::unordered_map<std::string, TelegramMethodStatistics>&
+  GetStatistics() const;
+
+ private:
+  struct Method {
+    // https://host/bot<token>/method
+    std::string url;
+    TelegramMethodSettings settings;
+  };
+
+  template <typename Result>
+  TelegramCall<Result> Call(const std::string& method,
+                            const userver::formats::json::Value& body,
+                            std::chrono::milliseconds extra_timeout = {}) const;
+
+  userver::clients::http::Client& http_client_;
+  const bool use_http2_;
+  std::unordered_map<std::string, Method> methods_;
+  // filled in the constructor, so is read without locks
+  mutable std::unordered_map<std::string, TelegramMethodStatistics>
+      statistics_;
+};
+
+}  // namespace telegram_bot::components::bot::impl
@@ -0,0 +1,41 @@
+#include "telegram_types.hpp"
+
+#include <userver/formats/json/value.hpp>
+#include <userver/formats/parse/common_containers.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+TelegramMessage Parse(const userver::formats::json::Value& value,
+                      userver::formats::parse::To<TelegramMessage>) {
+  return {value["message_id"].As<int32_t>(),
+          value["chat"]["id"].As<int64_t>(),
+          value["text"].As<std::string>(std::string{})};
+}
+
+TelegramCallbackQuery Parse(
+    const userver::formats::json::Value& value,
+    userver::formats::parse::To<TelegramCallbackQuery>) {
+  const auto& id = value["id"];
+  return {id.IsString() ? id.As<std::string>()
+                        : std::to_string(id.As<int64_t>()),
+          value["from"]["id"].As<int64_t>(),
+          value["message"].As<std::optional<TelegramMessage>>(),
+          value["data"].As<std::string>(std::string{})};
+}
+
+TelegramUpdate Parse(const userver::formats::json::Value& value,
+                     userver::formats::parse::To<TelegramUpdate>) {
+  return {value["update_id"].As<int32_t>(),
+          value["message"].As<std::optional<TelegramMessage>>(),
+          value["callback_query"].As<std::optional<TelegramCallbackQuery>>()};
+}
+
+std::optional<std::string_view> GetCommand(const std::string_view text) {
+  if (!text.starts_with('/')) {
+    return std::nullopt;
+  }
+  const auto end = text.find_first_of(" @\n");
+  return text.substr(1, end == std::string_view::npos ? end : end - 1);
+}
+
+}  // namespace telegram_bot::components::bot::impl
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <userver/formats/json_fwd.hpp>
+#include <userver/formats/parse/to.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+// Only the fields of Bot API objects the bot reads
+
+struct TelegramMessage {
+  int32_t message_id{};
+  int64_t chat_id{};
+  std::string text;
+};
+
+struct TelegramCallbackQuery {
+  std::string id;
+  int64_t from_id{};
+  // unset for callbacks of inline messages
+  std::optional<TelegramMessage> message;
+  std::string data;
+};
+
+struct TelegramUpdate {
+  int32_t update_id{};
+  std::optional<TelegramMessage> message;
+  std::optional<TelegramCallbackQuery> callback_query;
+};
+
+TelegramMessage Parse(const userver::formats::json::Value& value,
+                      userver::formats::parse::To<TelegramMessage>);
+
+TelegramCallbackQuery Parse(const userver::formats::json::Value& value,
+                            userver::formats::parse::To<TelegramCallbackQuery>);
+
+TelegramUpdate Parse(const userver::formats::json::Value& value,
+                     userver::formats::parse::To<TelegramUpdate>);
+
+// Command of the message without the slash and the bot mention, e.g.
+// "add_birthday" for "/add_birthday@bot 01.02 Name"
+std::optional<std::string_view> GetCommand(std::string_view text);
+
+}  // namespace telegram_bot::components::bot::impl
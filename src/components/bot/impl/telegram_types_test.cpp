@@ -0,0 +1,70 @@
+#include "telegram_types.hpp"
+
+#include <userver/formats/json/serialize.hpp>
+#include <userver/formats/json/value.hpp>
+#include <userver/utest/utest.hpp>
+
+using telegram_bot::components::bot::impl::GetCommand;
+using telegram_bot::components::bot::impl::TelegramUpdate;
+
+TEST(TelegramTypes, ParseMessage) {
+  const auto update = userver::formats::json::FromString(R"({
+    "update_id": 10,
+    "message": {
+      "message_id": 2,
+      "date": 1,
+      "chat": {"id": 100500, "type": "private"},
+      "text": "/start"
+    }
+  })")
+                          .As<TelegramUpdate>();
+
+  EXPECT_EQ(update.update_id, 10);
+  ASSERT_TRUE(update.message.has_value());
+  EXPECT_EQ(update.message->message_id, 2);
+  EXPECT_EQ(update.message->chat_id, 100500);
+  EXPECT_EQ(update.message->text, "/start");
+  EXPECT_FALSE(update.callback_query.has_value());
+}
+
+TEST(TelegramTypes, ParseCallbackQuery) {
+  const auto update = userver::formats::json::FromString(R"({
+    "update_id": 11,
+    "callback_query": {
+      "id": "4382",
+      "from": {"id": 22222, "is_bot": false, "first_name": "Name"},
+      "chat_instance": "unknown",
+      "data": "button"
+    }
+  })")
+                          .As<TelegramUpdate>();
+
+  EXPECT_FALSE(update.message.has_value());
+  ASSERT_TRUE(update.callback_query.has_value());
+  EXPECT_EQ(update.callback_query->id, "4382");
+  EXPECT_EQ(update.callback_query->from_id, 22222);
+  EXPECT_FALSE(update.callback_query->message.has_value());
+  EXPECT_EQ(update.callback_query->data, "button");
+}
+
+TEST(TelegramTypes, ParseMessageWithoutText) {
+  const auto update = userver::formats::json::FromString(R"({
+    "update_id": 12,
+    "message": {"message_id": 3, "chat": {"id": 1}, "sticker": {}}
+  })")
+                          .As<TelegramUpdate>();
+
+  ASSERT_TRUE(update.message.has_value());
+  EXPECT_EQ(update.message->text, "");
+  EXPECT_EQ(GetCommand(update.message->text), std::nullopt);
+}
+
+TEST(TelegramTypes, GetCommand) {
+  EXPECT_EQ(GetCommand("/start"), "start");
+  EXPECT_EQ(GetCommand("/add_birthday 01.02 Name"), "add_birthday");
+  EXPECT_EQ(GetCommand("/add_birthday@bot 01.02 Name"), "add_birthday");
+  EXPECT_EQ(GetCommand("/timezone\nEurope/Moscow"), "timezone");
+  EXPECT_EQ(GetCommand("/"), "");
+  EXPECT_EQ(GetCommand("start"), std::nullopt);
+  EXPECT_EQ(GetCommand(""), std::nullopt);
+}
@@ -0,0 +1,68 @@
+#include "update_dispatcher.hpp"
+
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include <userver/logging/log.hpp>
+#include <userver/utils/assert.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+UpdateDispatcher::UpdateDispatcher(
+    userver::engine::TaskProcessor& task_processor,
+    const std::size_t max_in_flight)
+    : in_flight_semaphore_(max_in_flight), tasks_(task_processor) {
+  UINVARIANT(max_in_flight > 0, "max_in_flight must be positive");
+}
+
+UpdateDispatcher::~UpdateDispatcher() {
+  tasks_.CancelAndWait();
+  UASSERT(in_flight_ == 0);
+}
+
+void UpdateDispatcher::Dispatch(const models::ChatId chat_id,
+                                Handler handler) {
+  in_flight_semaphore_.lock_shared();
+  ++in_flight_;
+
+  std::lock_guard lock(mutex_);
+  auto [it, inserted] = chat_queues_.try_emplace(chat_id);
+  it->second.push_back(std::move(handler));
+  if (inserted) {
+    tasks_.CriticalAsyncDetach("update-dispatcher/chat",
+                               [this, chat_id] { Drain(chat_id); });
+  }
+}
+
+std::size_t UpdateDispatcher::GetInFlight() const { return in_flight_; }
+
+void UpdateDispatcher::Drain(const models::ChatId chat_id) {
+  while (true) {
+    Handler handler;
+    {
+      std::lock_guard lock(mutex_);
+      const auto it = chat_queues_.find(chat_id);
+      UASSERT(it != chat_queues_.end());
+      if (it->second.empty()) {
+        chat_queues_.erase(it);
+        return;
+      }
+      // the chat stays in the map while the handler runs, so new updates of
+      // the chat are queued behind it
+      handler = std::move(it->second.front());
+      it->second.pop_front();
+    }
+
+    try {
+      handler();
+    } catch (const std::exception& exc) {
+      LOG_ERROR() << "Failed to handle update of chat "
+                  << chat_id.GetUnderlying() << ": " << exc;
+    }
+    --in_flight_;
+    in_flight_semaphore_.unlock_shared();
+  }
+}
+
+}  // namespace telegram_bot::components::bot::impl
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+#include <userver/concurrent/background_task_storage.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/semaphore.hpp>
+#include <userver/engine/task/task_processor_fwd.hpp>
+
+#include <models/user.hpp>
+
+namespace telegram_bot::components::bot::impl {
+
+// Runs handlers of updates from different chats concurrently, handlers of
+// updates from the same chat run one after another in the dispatch order
+class UpdateDispatcher final {
+ public:
+  using Handler = std::function<void()>;
+
+  UpdateDispatcher(userver::engine::TaskProcessor& task_processor,
+                   std::size_t max_in_flight);
+  // Runs the queued handlers, they see the cancellation
+  ~UpdateDispatcher();
+
+  // Blocks while max_in_flight handlers are queued or running, exceptions of
+  // the handler are logged
+  void Dispatch(models::ChatId chat_id, Handler handler);
+
+  // queued and running handlers
+  std::size_t GetInFlight() const;
+
+ private:
+  // Runs handlers of the chat until its queue is empty
+  void Drain(models::ChatId chat_id);
+
+  userver::engine::Semaphore in_flight_semaphore_;
+  std::atomic<std::size_t> in_flight_{};
+  userver::engine::Mutex mutex_;
+  // chats which handlers are queued or running, a task drains each of them
+  std::unordered_map<models::ChatId, std::deque<Handler>> chat_queues_;
+  // the last member, so that tasks are cancelled before the queues go. Drain
+  // tasks are critical, a drainer cancelled before it starts would leave its
+  // chat in the map and the semaphore units of its handlers taken.
+  userver::concurrent::BackgroundTaskStorage tasks_;
+};
+
+}  // namespace telegram_bot::components::bot::impl
@@ -0,0 +1,113 @@
+#include "update_dispatcher.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include <userver/engine/single_consumer_event.hpp>
+#include <userver/engine/sleep.hpp>
+#include <userver/engine/task/current_task.hpp>
+#include <userver/utest/utest.hpp>
+#include <userver/utils/async.hpp>
+
+using telegram_bot::components::bot::impl::UpdateDispatcher;
+using telegram_bot::models::ChatId;
+
+namespace {
+
+const std::chrono::seconds kMaxWait{5};
+
+void WaitForIdle(const UpdateDispatcher& dispatcher) {
+  const auto deadline = std::chrono::steady_clock::now() + kMaxWait;
+  while (dispatcher.GetInFlight() > 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    userver::engine::SleepFor(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(dispatcher.GetInFlight(), 0);
+}
+
+}  // namespace
+
+UTEST_MT(UpdateDispatcher, SameChatInOrder, 4) {
+  UpdateDispatcher dispatcher{
+      userver::engine::current_task::GetTaskProcessor(), 10};
+  std::vector<int> handled;
+  for (int i = 0; i < 100; ++i) {
+    dispatcher.Dispatch(ChatId{1}, [&handled, i] {
+      if (i % 10 == 0) {
+        userver::engine::SleepFor(std::chrono::milliseconds(1));
+      }
+      handled.push_back(i);
+    });
+  }
+  WaitForIdle(dispatcher);
+
+  ASSERT_EQ(handled.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(handled[i], i);
+  }
+}
+
+UTEST(UpdateDispatcher, ChatsRunConcurrently) {
+  UpdateDispatcher dispatcher{
+      userver::engine::current_task::GetTaskProcessor(), 10};
+  userver::engine::SingleConsumerEvent event;
+  bool received = false;
+  // the first chat waits for the second one, deadlocks if chats were serial
+  dispatcher.Dispatch(ChatId{1},
+                      [&] { received = event.WaitForEventFor(kMaxWait); });
+  dispatcher.Dispatch(ChatId{2}, [&] { event.Send(); });
+  WaitForIdle(dispatcher);
+
+  EXPECT_TRUE(received);
+}
+
+UTEST(UpdateDispatcher, FailedHandlerDoesNotBlockChat) {
+  UpdateDispatcher dispatcher{
+      userver::engine::current_task::GetTaskProcessor(), 10};
+  bool handled = false;
+  dispatcher.Dispatch(ChatId{1}, [] { throw std::runtime_error("failure"); });
+  dispatcher.Dispatch(ChatId{1}, [&handled] { handled = true; });
+  WaitForIdle(dispatcher);
+
+  EXPECT_TRUE(handled);
+}
+
+UTEST(UpdateDispatcher, BoundsInFlight) {
+  UpdateDispatcher dispatcher{
+      userver::engine::current_task::GetTaskProcessor(), 2};
+  userver::engine::SingleConsumerEvent release_first;
+  userver::engine::SingleConsumerEvent release_second;
+  dispatcher.Dispatch(ChatId{1}, [&] {
+    EXPECT_TRUE(release_first.WaitForEventFor(kMaxWait));
+  });
+  dispatcher.Dispatch(ChatId{2}, [&] {
+    EXPECT_TRUE(release_second.WaitForEventFor(kMaxWait));
+  });
+  EXPECT_EQ(dispatcher.GetInFlight(), 2);
+
+  auto third = userver::utils::Async("dispatch", [&dispatcher] {
+    dispatcher.Dispatch(ChatId{3}, [] {});
+  });
+  third.WaitFor(std::chrono::milliseconds(50));
+  EXPECT_FALSE(third.IsFinished());
+
+  release_first.Send();
+  third.Get();
+  release_second.Send();
+  WaitForIdle(dispatcher);
+}
+
+UTEST(UpdateDispatcher, CancelledDrainersRunQueuedHandlers) {
+  int handled = 0;
+  {
+    UpdateDispatcher dispatcher{
+        userver::engine::current_task::GetTaskProcessor(), 10};
+    dispatcher.Dispatch(ChatId{1}, [&handled] { ++handled; });
+    dispatcher.Dispatch(ChatId{1}, [&handled] { ++handled; });
+    dispatcher.Dispatch(ChatId{2}, [&handled] { ++handled; });
+    // the drainers have not started on the single thread yet, the destructor
+    // cancels them and checks that nothing is left in flight
+  }
+  EXPECT_EQ(handled, 3);
+}
@@ -0,0 +1,215 @@
+#include "notification_sender.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/statistics_storage.hpp>
+#include <userver/engine/async.hpp>
+#include <userver/engine/sleep.hpp>
+#include <userver/engine/task/cancel.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/component.hpp>
+#include <userver/testsuite/testsuite_support.hpp>
+#include <userver/tracing/span.hpp>
+#include <userver/utils/statistics/writer.hpp>
+#include <userver/yaml_config/merge_schemas.hpp>
+
+#include <db/notification_outbox.hpp>
+#include <utils/statistics.hpp>
+
+namespace telegram_bot::components {
+
+namespace {
+
+const std::string kComponentConfigSchema = R"(
+type: object
+description: Delivers notifications from the outbox
+additionalProperties: false
+properties:
+    workers:
+        description: Number of concurrent delivery workers of the instance
+        type: integer
+        minimum: 1
+        defaultDescription: 16
+    batch_size:
+        description: Number of notifications a worker claims at once
+        type: integer
+        minimum: 1
+        defaultDescription: 10
+    poll_interval:
+        description: Sleep of a worker which found no notifications
+        type: string
+        defaultDescription: 1s
+    lease:
+        description: |
+            How long claimed notifications are hidden from other workers,
+            notifications of a crashed worker are retried after it. Renewed
+            before every send, so must exceed the longest single send
+            including waits for the rate limits.
+        type: string
+        defaultDescription: 10m
+    min_retry_delay:
+        description: Delay before the second attempt, doubled on every failure
+        type: string
+        defaultDescription: 10s
+    max_retry_delay:
+        description: Maximum delay between attempts
+        type: string
+        defaultDescription: 1h
+    max_attempts:
+        description: Notifications are dropped after this number of attempts
+        type: integer
+        minimum: 1
+        defaultDescription: 10
+)";
+
+}  // namespace
+
+const std::string NotificationSender::kName = "notification-sender";
+
+userver::yaml_config::Schema NotificationSender::GetStaticConfigSchema() {
+  return userver::yaml_config::MergeSchemas<
+      userver::components::LoggableComponentBase>(kComponentConfigSchema);
+}
+
+NotificationSender::NotificationSender(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& context)
+    : userver::components::LoggableComponentBase(config, context),
+      postgres_(
+          context.FindComponent<userver::components::Postgres>("postgres-db")
+              .GetCluster()),
+      bot_(context.FindComponent<bot::Component>()),
+      testsuite_tasks_(
+          context.FindComponent<userver::components::TestsuiteSupport>()
+              .GetTestsuiteTasks()) {
+  batch_size_ = config["batch_size"].As<std::size_t>(10);
+  poll_interval_ = config["poll_interval"].As<std::chrono::milliseconds>(
+      std::chrono::seconds(1));
+  lease_ = config["lease"].As<std::chrono::seconds>(std::chrono::minutes(10));
+  min_retry_delay_ = config["min_retry_delay"].As<std::chrono::seconds>(
+      std::chrono::seconds(10));
+  max_retry_delay_ = config["max_retry_delay"].As<std::chrono::seconds>(
+      std::chrono::hours(1));
+  max_attempts_ = config["max_attempts"].As<int32_t>(10);
+
+  auto& storage =
+      context.FindComponent<userver::components::StatisticsStorage>()
+          .GetStorage();
+  statistics_holder_ = storage.RegisterWriter(
+      kName, [this](userver::utils::statistics::Writer& writer) {
+        writer["sent"] = metrics_.sent;
+        writer["send-failures"] = metrics_.send_failures;
+        writer["dropped"] = metrics_.dropped;
+        utils::WritePercentiles(writer["send-time-ms"], metrics_.send_timings);
+      });
+
+  // Tests deliver notifications on demand
+  if (testsuite_tasks_.IsEnabled()) {
+    testsuite_tasks_.RegisterTask(kName, [this] {
+      while (DeliverBatch() > 0) {
+      }
+    });
+    return;
+  }
+
+  const auto workers = config["workers"].As<std::size_t>(16);
+  for (std::size_t index = 0; index < workers; ++index) {
+    userver::tracing::Span span{kName};
+    span.DetachFromCoroStack();
+    workers_.push_back(userver::engine::AsyncNoSpan(
+        [this, span = std::move(span)]() mutable {
+          span.AttachToCoroStack();
+          RunWorker();
+        }));
+  }
+}
+
+NotificationSender::~NotificationSender() {
+  if (testsuite_tasks_.IsEnabled()) {
+    testsuite_tasks_.UnregisterTask(kName);
+  }
+  for (auto& worker : workers_) {
+    worker.SyncCancel();
+  }
+}
+
+void NotificationSender::RunWorker() {
+  while (!userver::engine::current_task::ShouldCancel()) {
+    std::size_t claimed = 0;
+    try {
+      claimed = DeliverBatch();
+    } catch (const std::exception& exc) {
+      LOG_ERROR() << "Failed to deliver notifications: " << exc;
+    }
+    if (claimed == 0) {
+      userver::engine::InterruptibleSleepFor(poll_interval_);
+    }
+  }
+}
+
+std::size_t NotificationSender::DeliverBatch() {
+  const auto notifications =
+      db::ClaimNotifications(batch_size_, lease_, *postgres_);
+  for (const auto& notification : notifications) {
+    Deliver(notification);
+  }
+  return notifications.size();
+}
+
+void NotificationSender::Deliver(
+    const models::OutboxNotification& notification) {
+  // the sends of the batch before this one used up a part of the lease
+  db::RescheduleNotification(notification.id, lease_, *postgres_);
+
+  const auto send_start = std::chrono::steady_clock::now();
+  try {
+    bot_.SendMessage(notification.chat_id, notification.text);
+    metrics_.send_timings.GetCurrentCounter().Account(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - send_start)
+            .count());
+  } catch (const std::exception& exc) {
+    ++metrics_.send_failures;
+    if (notification.attempts >= max_attempts_) {
+      ++metrics_.dropped;
+      LOG_ERROR() << "Drop notification " << notification.id << " to chat "
+                  << notification.chat_id << " after "
+                  << notification.attempts << " attempts: " << exc;
+      db::DeleteNotification(notification.id, *postgres_);
+      return;
+    }
+
+    const auto delay = impl::GetRetryDelay(
+        notification.attempts, min_retry_delay_, max_retry_delay_);
+    LOG_WARNING() << "Failed to send notification " << notification.id
+                  << " to chat " << notification.chat_id << ", retry in "
+                  << delay.count() << "s: " << exc;
+    db::RescheduleNotification(notification.id, delay, *postgres_);
+    return;
+  }
+
+  ++metrics_.sent;
+  db::DeleteNotification(notification.id, *postgres_);
+}
+
+namespace impl {
+
+std::chrono::seconds GetRetryDelay(const int32_t attempts,
+                                   const std::chrono::seconds min_delay,
+                                   const std::chrono::seconds max_delay) {
+  auto delay = min_delay;
+  for (int32_t attempt = 1; attempt < attempts && delay < max_delay;
+       ++attempt) {
+    delay *= 2;
+  }
+  return std::min(delay, max_delay);
+}
+
+}  // namespace impl
+
+}  // namespace telegram_bot::components
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <userver/components/loggable_component_base.hpp>
+#include <userver/engine/task/task_with_result.hpp>
+#include <userver/storages/postgres/postgres_fwd.hpp>
+#include <userver/testsuite/tasks.hpp>
+#include <userver/utils/statistics/entry.hpp>
+#include <userver/utils/statistics/percentile.hpp>
+#include <userver/utils/statistics/recentperiod.hpp>
+#include <userver/yaml_config/schema.hpp>
+
+#include <components/bot/component.hpp>
+#include <models/notification.hpp>
+
+namespace telegram_bot::components {
+
+namespace impl {
+
+struct SenderMetrics {
+  std::atomic<int64_t> sent{};
+  std::atomic<int64_t> send_failures{};
+  std::atomic<int64_t> dropped{};
+  // milliseconds
+  userver::utils::statistics::RecentPeriod<
+      userver::utils::statistics::Percentile<2048>,
+      userver::utils::statistics::Percentile<2048>>
+      send_timings;
+};
+
+}  // namespace impl
+
+// Delivers notifications planned by the notificator from the outbox, workers
+// of all instances share the outbox
+class NotificationSender final
+    : public userver::components::LoggableComponentBase {
+ public:
+  static const std::string kName;
+
+  NotificationSender(const userver::components::ComponentConfig&,
+                     const userver::components::ComponentContext&);
+
+  ~NotificationSender() override;
+
+  static userver::yaml_config::Schema GetStaticConfigSchema();
+
+ private:
+  userver::storages::postgres::ClusterPtr postgres_;
+  bot::Component& bot_;
+  userver::testsuite::TestsuiteTasks& testsuite_tasks_;
+  std::size_t batch_size_{};
+  std::chrono::milliseconds poll_interval_{};
+  std::chrono::seconds lease_{};
+  std::chrono::seconds min_retry_delay_{};
+  std::chrono::seconds max_retry_delay_{};
+  int32_t max_attempts_{};
+  impl::SenderMetrics metrics_;
+  userver::utils::statistics::Entry statistics_holder_;
+  std::vector<userver::engine::TaskWithResult<void>> workers_;
+
+ private:
+  void RunWorker();
+  // returns the number of claimed notifications
+  std::size_t DeliverBatch();
+  void Deliver(const models::OutboxNotification& notification);
+};
+
+namespace impl {
+
+// Exponential backoff, attempts count from 1
+std::chrono::seconds GetRetryDelay(int32_t attempts,
+                                   std::chrono::seconds min_delay,
+                                   std::chrono::seconds max_delay);
+
+}  // namespace impl
+
+}  // namespace telegram_bot::components
@@ -0,0 +1,16 @@
+#include "notification_sender.hpp"
+
+#include <userver/utest/utest.hpp>
+
+using telegram_bot::components::impl::GetRetryDelay;
+
+TEST(GetRetryDelay, Backoff) {
+  const std::chrono::seconds min_delay(10);
+  const std::chrono::seconds max_delay(100);
+  EXPECT_EQ(GetRetryDelay(1, min_delay, max_delay), std::chrono::seconds(10));
+  EXPECT_EQ(GetRetryDelay(2, min_delay, max_delay), std::chrono::seconds(20));
+  EXPECT_EQ(GetRetryDelay(4, min_delay, max_delay), std::chrono::seconds(80));
+  EXPECT_EQ(GetRetryDelay(5, min_delay, max_delay), std::chrono::seconds(100));
+  EXPECT_EQ(GetRetryDelay(1000, min_delay, max_delay),
+            std::chrono::seconds(100));
+}
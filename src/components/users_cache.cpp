@@ -0,0 +1,22 @@
+#include "users_cache.hpp"
+
+#include <userver/components/component_context.hpp>
+#include <userver/storages/postgres/component.hpp>
+
+#include <db/users.hpp>
+
+namespace telegram_bot::components {
+
+UsersCache::UsersCache(const userver::components::ComponentConfig& config,
+                       const userver::components::ComponentContext& context)
+    : LruCacheComponent(config, context),
+      postgres_(
+          context.FindComponent<userver::components::Postgres>("postgres-db")
+              .GetCluster()) {}
+
+std::optional<models::User> UsersCache::DoGetByKey(
+    const models::ChatId& chat_id) {
+  return db::FindUser(chat_id, *postgres_);
+}
+
+}  // namespace telegram_bot::components
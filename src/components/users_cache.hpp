@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+#include <userver/cache/lru_cache_component_base.hpp>
+#include <userver/storages/postgres/postgres_fwd.hpp>
+
+#include <models/user.hpp>
+
+namespace telegram_bot::components {
+
+// Users by chat id for the command handlers. Handlers of the same replica
+// invalidate the users they change, the other replicas see the changes after
+// the lifetime of the entries, so the handlers which change data check that
+// the user still exists.
+class UsersCache final
+    : public userver::cache::LruCacheComponent<models::ChatId,
+                                               std::optional<models::User>> {
+ public:
+  static constexpr std::string_view kName = "users-cache";
+
+  UsersCache(const userver::components::ComponentConfig&,
+             const userver::components::ComponentContext&);
+
+ private:
+  std::optional<models::User> DoGetByKey(
+      const models::ChatId& chat_id) override;
+
+  userver::storages::postgres::ClusterPtr postgres_;
+};
+
+}  // namespace telegram_bot::components
@@ -1,14 +1,25 @@
 #include "birthdays.hpp"
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
 
 #include <userver/storages/postgres/cluster.hpp>
+#include <userver/storages/postgres/result_set.hpp>
+#include <userver/utils/assert.hpp>
 
 namespace telegram_bot::db {
 
 namespace {
 
-const std::string kAllBirthdaysQuery = R"(
+// Range scan over birthdays_next_occurrence_idx, next occurrences move past
+// the window once they are notified. Pages are keyed by the index order, so
+// no transaction is held between them and every page starts with an index
+// lookup.
+const std::string kBirthdaysInWindowQuery = R"(
 SELECT
   birthdays.id,
   birthdays.person,
@@ -16,23 +27,124 @@ SELECT
   birthdays.m,
   birthdays.d,
   birthdays.notification_enabled,
-  birthdays.last_notification_time,
-  birthdays.user_id
+  (
+    SELECT max(notifications_sent.year)
+    FROM birthday.notifications_sent
+    WHERE notifications_sent.birthday_id = birthdays.id
+  ) AS last_notified_year,
+  birthdays.user_id,
+  birthdays.next_occurrence::TEXT
 FROM birthday.birthdays
+JOIN birthday.users
+  ON users.id = birthdays.user_id
+WHERE birthdays.notification_enabled
+  AND birthdays.next_occurrence BETWEEN $1::DATE AND $2::DATE
+  AND (birthdays.next_occurrence, birthdays.id) > ($6::DATE, $7)
+  AND birthdays.user_id % $3 = $4
+  AND users.notification_bucket = $5
+ORDER BY birthdays.next_occurrence, birthdays.id
+LIMIT $8
 )";
 
-const std::string kBirthdaysByUserIdQuery = R"(
-SELECT
-  birthdays.id,
-  birthdays.person,
-  birthdays.y,
+// Occurrences before the window were not notified, e.g. notifications were
+// disabled, they are skipped as the notificator never looks back further
+const std::string kAdvancePassedOccurrencesQuery = R"(
+UPDATE birthday.birthdays
+SET next_occurrence = birthday.first_occurrence_since(
   birthdays.m,
   birthdays.d,
-  birthdays.notification_enabled,
-  birthdays.last_notification_time,
-  birthdays.user_id
-FROM birthday.birthdays
-WHERE birthdays.user_id = $1
+  $1::DATE
+)
+FROM birthday.users
+WHERE users.id = birthdays.user_id
+  AND birthdays.next_occurrence < $1::DATE
+  AND birthdays.user_id % $2 = $3
+  AND users.notification_bucket = $4
+)";
+
+// Top-k by the first occurrences since the local day, birthdays of the day
+// go first. next_occurrence is not enough: birthdays notified today are
+// moved to the next year, passed ones may be not advanced yet. Coming
+// occurrences and those moved today (a year ahead, a day either way for
+// Feb 29) are read in the index order of
+// birthdays_user_id_next_occurrence_idx and stop at the limit, passed ones
+// are sorted by their occurrences.
+const std::string kNextBirthdaysQuery = R"(
+SELECT
+  next.id,
+  next.person,
+  next.y,
+  next.m,
+  next.d,
+  next.notification_enabled,
+  (
+    SELECT max(notifications_sent.year)
+    FROM birthday.notifications_sent
+    WHERE notifications_sent.birthday_id = next.id
+  ) AS last_notified_year,
+  next.user_id
+FROM (
+  (
+    SELECT
+      birthdays.id,
+      birthdays.person,
+      birthdays.y,
+      birthdays.m,
+      birthdays.d,
+      birthdays.notification_enabled,
+      birthdays.user_id
+    FROM birthday.birthdays
+    WHERE birthdays.user_id = $1
+      AND birthdays.next_occurrence >= $2::DATE
+    ORDER BY birthdays.next_occurrence, birthdays.id
+    LIMIT $3
+  )
+  UNION
+  (
+    SELECT
+      birthdays.id,
+      birthdays.person,
+      birthdays.y,
+      birthdays.m,
+      birthdays.d,
+      birthdays.notification_enabled,
+      birthdays.user_id
+    FROM birthday.birthdays
+    WHERE birthdays.user_id = $1
+      AND birthdays.next_occurrence
+        BETWEEN ($2::DATE + INTERVAL '1 year')::DATE - 1
+            AND ($2::DATE + INTERVAL '1 year')::DATE + 1
+      AND birthday.first_occurrence_since(
+        birthdays.m,
+        birthdays.d,
+        $2::DATE
+      ) = $2::DATE
+    ORDER BY birthdays.next_occurrence, birthdays.id
+    LIMIT $3
+  )
+  UNION
+  (
+    SELECT
+      birthdays.id,
+      birthdays.person,
+      birthdays.y,
+      birthdays.m,
+      birthdays.d,
+      birthdays.notification_enabled,
+      birthdays.user_id
+    FROM birthday.birthdays
+    WHERE birthdays.user_id = $1
+      AND birthdays.next_occurrence < $2::DATE
+    ORDER BY
+      birthday.first_occurrence_since(birthdays.m, birthdays.d, $2::DATE),
+      birthdays.id
+    LIMIT $3
+  )
+) AS next
+ORDER BY
+  birthday.first_occurrence_since(next.m, next.d, $2::DATE),
+  next.id
+LIMIT $3
 )";
 
 const std::string kDeleteBirthdayQuery = R"(
@@ -47,12 +159,6 @@ FROM birthday.birthdays
 WHERE birthdays.user_id = $1
 )";
 
-const std::string kUpdateLastNotificationTime = R"(
-UPDATE birthday.birthdays
-SET last_notification_time = $1
-WHERE birthdays.id = $2
-)";
-
 const std::string kInsertBirthday = R"(
 INSERT INTO birthday.birthdays(
   person,
@@ -60,18 +166,19 @@ INSERT INTO birthday.birthdays(
   m,
   d,
   notification_enabled,
-  last_notification_time,
+  next_occurrence,
   user_id
 )
-VALUES (
+SELECT
   $1,
   $2,
   $3,
   $4,
   true,
-  null,
-  $5
-)
+  birthday.first_occurrence_since($3, $4, $6::DATE),
+  users.id
+FROM birthday.users
+WHERE users.id = $5
 )";
 
 const std::string kCheckOwnershipQuery = R"(
@@ -80,23 +187,92 @@ FROM birthday.birthdays
 WHERE birthdays.id = $1
 )";
 
+std::string FormatDay(const cctz::civil_day& day) {
+  return fmt::format("{:04}-{:02}-{:02}", day.year(), day.month(), day.day());
+}
+
+// Columns of birthdays.person and birthdays.next_occurrence in the birthdays
+// in window query
+const std::size_t kPersonColumn = 1;
+const std::size_t kNextOccurrenceColumn = 8;
+
+// Names are read as views into the result set and copied into the batch
+models::BirthdayBatch DecodeBirthdays(
+    const userver::storages::postgres::ResultSet& rows) {
+  std::size_t names_size = 0;
+  for (const auto& row : rows) {
+    names_size += row[kPersonColumn].As<std::string_view>().size();
+  }
+
+  models::BirthdayBatch batch(rows.Size(), names_size);
+  for (const auto& row : rows) {
+    models::BirthdayBatch::Record record;
+    row[0].To(record.id);
+    row[kPersonColumn].To(record.person);
+    row[2].To(record.y);
+    row[3].To(record.m);
+    row[4].To(record.d);
+    row[5].To(record.notification_enabled);
+    row[6].To(record.last_notified_year);
+    row[7].To(record.user_id);
+    batch.Append(record);
+  }
+  return batch;
+}
+
 }  // namespace
 
-std::vector<models::Birthday> FetchAllBirthdays(
+void StreamBirthdaysInWindow(
+    const cctz::civil_day& first_day, const cctz::civil_day& last_day,
+    const models::UserShard& shard, const models::NotificationBucket& bucket,
+    const std::size_t chunk_size,
+    const std::function<void(models::BirthdayBatch&&)>& handle_chunk,
     userver::storages::postgres::Cluster& postgres) {
-  return postgres
-      .Execute(userver::storages::postgres::ClusterHostType::kMaster,
-               kAllBirthdaysQuery)
-      .AsContainer<std::vector<models::Birthday>>(
-          userver::storages::postgres::kRowTag);
+  UINVARIANT(first_day <= last_day && last_day - first_day < 365,
+             "Birthdays window must be shorter than a year");
+  UINVARIANT(chunk_size > 0, "Chunk size must be positive");
+
+  // every page is a separate statement, the slow handle_chunk runs without an
+  // open transaction
+  auto after_day = FormatDay(first_day);
+  models::BirthdayId after_id{0};
+  while (true) {
+    const auto rows = postgres.Execute(
+        userver::storages::postgres::ClusterHostType::kMaster,
+        kBirthdaysInWindowQuery, FormatDay(first_day), FormatDay(last_day),
+        shard.count, shard.index, bucket.GetKey(), after_day, after_id,
+        static_cast<int64_t>(chunk_size));
+    if (rows.IsEmpty()) {
+      return;
+    }
+
+    const auto last_row = rows[rows.Size() - 1];
+    last_row[kNextOccurrenceColumn].To(after_day);
+    last_row[0].To(after_id);
+    const bool last_page = rows.Size() < chunk_size;
+    handle_chunk(DecodeBirthdays(rows));
+    if (last_page) {
+      return;
+    }
+  }
 }
 
-std::vector<models::Birthday> FetchBirthdays(
-    const models::UserId user_id,
-    userver::storages::postgres::Cluster& postgres) {
+void AdvancePassedOccurrences(const cctz::civil_day& first_day,
+                              const models::UserShard& shard,
+                              const models::NotificationBucket& bucket,
+                              userver::storages::postgres::Cluster& postgres) {
+  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                   kAdvancePassedOccurrencesQuery, FormatDay(first_day),
+                   shard.count, shard.index, bucket.GetKey());
+}
+
+std::vector<models::Birthday> FetchNextBirthdays(
+    const models::UserId user_id, const cctz::civil_day& local_day,
+    const std::size_t limit, userver::storages::postgres::Cluster& postgres) {
   return postgres
       .Execute(userver::storages::postgres::ClusterHostType::kMaster,
-               kBirthdaysByUserIdQuery, user_id)
+               kNextBirthdaysQuery, user_id, FormatDay(local_day),
+               static_cast<int64_t>(limit))
       .AsContainer<std::vector<models::Birthday>>(
           userver::storages::postgres::kRowTag);
 }
@@ -124,21 +300,19 @@ void DeleteAllBirthdays(const models::UserId user_id,
                    kDeleteAllUserBirthdaysQuery, user_id);
 }
 
-void UpdateBirthdayLastNotificationTime(
-    const models::TimePoint last_notification_time, const models::BirthdayId id,
-    userver::storages::postgres::Cluster& postgres) {
-  postgres.Execute(
-      userver::storages::postgres::ClusterHostType::kMaster,
-      kUpdateLastNotificationTime,
-      userver::storages::postgres::TimePointTz{last_notification_time}, id);
-}
-
-void InsertBirthday(const models::BirthdayMonth m, const models::BirthdayDay d,
+bool InsertBirthday(const models::BirthdayMonth m, const models::BirthdayDay d,
                     const std::optional<models::BirthdayYear> y,
                     const std::string& person, const models::UserId user_id,
+                    const cctz::civil_day& local_day,
                     userver::storages::postgres::Cluster& postgres) {
-  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
-                   kInsertBirthday, person, y, m, d, user_id);
+  // a birthday passed a few days ago is notified as a forgotten one
+  const auto first_day =
+      local_day - models::kForgottenBirthdaySearchDistance.count();
+  return postgres
+             .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                      kInsertBirthday, person, y, m, d, user_id,
+                      FormatDay(first_day))
+             .RowsAffected() > 0;
 }
 
 }  // namespace telegram_bot::db
\ No newline at end of file
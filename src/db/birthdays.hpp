@@ -1,19 +1,46 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <optional>
+#include <vector>
+
+#include <cctz/civil_time.h>
 
 #include <userver/storages/postgres/postgres_fwd.hpp>
 
 #include <models/birthday.hpp>
+#include <models/birthday_batch.hpp>
 #include <models/time_point.hpp>
+#include <models/user.hpp>
 
 namespace telegram_bot::db {
 
-std::vector<models::Birthday> FetchAllBirthdays(
+// Only birthdays of the shard users from the notification bucket with enabled
+// notification which next occurrence falls into the [first_day, last_day]
+// window, the window may cross the new year. Rows are read in pages of
+// chunk_size rows ordered by next occurrence, each page with its own
+// statement, and handed out one page per chunk, rows of a user may be spread
+// over several chunks.
+void StreamBirthdaysInWindow(
+    const cctz::civil_day& first_day, const cctz::civil_day& last_day,
+    const models::UserShard& shard, const models::NotificationBucket& bucket,
+    std::size_t chunk_size,
+    const std::function<void(models::BirthdayBatch&&)>& handle_chunk,
     userver::storages::postgres::Cluster& postgres);
 
-std::vector<models::Birthday> FetchBirthdays(
-    models::UserId user_id, userver::storages::postgres::Cluster& postgres);
+// Moves next occurrences before first_day of the shard users from the
+// notification bucket to the first ones since first_day
+void AdvancePassedOccurrences(const cctz::civil_day& first_day,
+                              const models::UserShard& shard,
+                              const models::NotificationBucket& bucket,
+                              userver::storages::postgres::Cluster& postgres);
+
+// At most limit birthdays of the user ordered by their first occurrences
+// since local_day, the current day of the user, even if notified already
+std::vector<models::Birthday> FetchNextBirthdays(
+    models::UserId user_id, const cctz::civil_day& local_day,
+    std::size_t limit, userver::storages::postgres::Cluster& postgres);
 
 bool IsOwnerOfBirthday(models::UserId user_id, models::BirthdayId birthday_id,
                        userver::storages::postgres::Cluster& postgres);
@@ -24,13 +51,11 @@ void DeleteBirthday(models::BirthdayId birthday_id,
 void DeleteAllBirthdays(models::UserId user_id,
                         userver::storages::postgres::Cluster& postgres);
 
-void UpdateBirthdayLastNotificationTime(
-    models::TimePoint last_notification_time, models::BirthdayId id,
-    userver::storages::postgres::Cluster& postgres);
-
-void InsertBirthday(models::BirthdayMonth m, models::BirthdayDay d,
+// Returns false if the user is missing
+bool InsertBirthday(models::BirthdayMonth m, models::BirthdayDay d,
                     std::optional<models::BirthdayYear> y,
                     const std::string& person, models::UserId user_id,
+                    const cctz::civil_day& local_day,
                     userver::storages::postgres::Cluster& postgres);
 
 }  // namespace telegram_bot::db
\ No newline at end of file
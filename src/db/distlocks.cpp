@@ -0,0 +1,45 @@
+#include "distlocks.hpp"
+
+#include <fmt/format.h>
+
+#include <userver/storages/postgres/cluster.hpp>
+
+namespace telegram_bot::db {
+
+namespace {
+
+// table name comes from the static config of the distlock component
+const std::string kCountLiveLocksQuery = R"(
+SELECT COUNT(*)
+FROM {}
+WHERE left(key, length($1)) = $1
+  AND expiration_time > now()
+)";
+
+const std::string kDeleteExpiredLocksQuery = R"(
+DELETE
+FROM {}
+WHERE left(key, length($1)) = $1
+  AND expiration_time < now() - make_interval(secs => $2)
+)";
+
+}  // namespace
+
+int64_t CountLiveLocks(const std::string& table, const std::string& key_prefix,
+                       userver::storages::postgres::Cluster& postgres) {
+  return postgres
+      .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+               fmt::format(kCountLiveLocksQuery, table), key_prefix)
+      .AsSingleRow<int64_t>();
+}
+
+void DeleteExpiredLocks(const std::string& table,
+                        const std::string& key_prefix,
+                        const std::chrono::seconds expired_for,
+                        userver::storages::postgres::Cluster& postgres) {
+  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                   fmt::format(kDeleteExpiredLocksQuery, table), key_prefix,
+                   static_cast<double>(expired_for.count()));
+}
+
+}  // namespace telegram_bot::db
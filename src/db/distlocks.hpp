@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <userver/storages/postgres/postgres_fwd.hpp>
+
+namespace telegram_bot::db {
+
+// Number of not expired locks which key starts with key_prefix
+int64_t CountLiveLocks(const std::string& table, const std::string& key_prefix,
+                       userver::storages::postgres::Cluster& postgres);
+
+void DeleteExpiredLocks(const std::string& table,
+                        const std::string& key_prefix,
+                        std::chrono::seconds expired_for,
+                        userver::storages::postgres::Cluster& postgres);
+
+}  // namespace telegram_bot::db
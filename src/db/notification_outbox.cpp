@@ -0,0 +1,273 @@
+#include "notification_outbox.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+#include <fmt/format.h>
+
+#include <userver/storages/postgres/cluster.hpp>
+#include <userver/utils/assert.hpp>
+
+namespace telegram_bot::db {
+
+namespace {
+
+// The birthdays are locked, so a birthday deleted meanwhile is skipped and
+// its deletion waits for the notification to be planned. Occurrences planned
+// by a concurrent planner conflict and are not returned.
+const std::string kRecordOccurrencesQuery = R"(
+INSERT INTO birthday.notifications_sent(
+  birthday_id,
+  year
+)
+SELECT
+  occurrences.birthday_id,
+  occurrences.year
+FROM UNNEST(
+  $1::INTEGER[],
+  $2::INTEGER[]
+) AS occurrences(
+  birthday_id,
+  year
+)
+JOIN birthday.birthdays
+  ON birthdays.id = occurrences.birthday_id
+FOR KEY SHARE OF birthdays
+ON CONFLICT (birthday_id, year) DO NOTHING
+RETURNING notifications_sent.birthday_id
+)";
+
+// Occurrences are the ones just recorded. A notification of the user for the
+// day which is not claimed yet gets the new text appended. A claimed one may
+// be being sent, so the occurrences of its user are taken back from the
+// ledger and planned again later. Next occurrences of the notified birthdays
+// move to the following year.
+const std::string kQueueNotificationsQuery = R"(
+WITH occurrences AS (
+  SELECT
+    occurrences.user_id,
+    occurrences.birthday_id,
+    occurrences.year,
+    occurrences.celebrate_today,
+    occurrences.title,
+    occurrences.position
+  FROM UNNEST(
+    $2::INTEGER[],
+    $3::INTEGER[],
+    $4::INTEGER[],
+    $5::INTEGER[]::BOOLEAN[],
+    $6::TEXT[]
+  ) WITH ORDINALITY AS occurrences(
+    user_id,
+    birthday_id,
+    year,
+    celebrate_today,
+    title,
+    position
+  )
+),
+queued AS (
+  INSERT INTO birthday.notification_outbox(
+    user_id,
+    local_day,
+    text
+  )
+  SELECT
+    occurrences.user_id,
+    $1::DATE,
+    concat_ws(
+      E'\n',
+      'Today is birthday of ' || string_agg(
+        occurrences.title,
+        ', '
+        ORDER BY occurrences.position
+      ) FILTER (WHERE occurrences.celebrate_today),
+      E'You forgot about birthdays: \n' || string_agg(
+        occurrences.title,
+        E'\n'
+        ORDER BY occurrences.position
+      ) FILTER (WHERE NOT occurrences.celebrate_today)
+    )
+  FROM occurrences
+  GROUP BY occurrences.user_id
+  ON CONFLICT (user_id, local_day) DO UPDATE
+  SET text = notification_outbox.text || E'\n' || excluded.text
+  WHERE notification_outbox.attempts = 0
+  RETURNING notification_outbox.user_id
+),
+postponed AS (
+  DELETE
+  FROM birthday.notifications_sent
+  USING occurrences
+  WHERE notifications_sent.birthday_id = occurrences.birthday_id
+    AND notifications_sent.year = occurrences.year
+    AND occurrences.user_id NOT IN (
+      SELECT queued.user_id
+      FROM queued
+    )
+  RETURNING occurrences.user_id
+),
+advanced AS (
+  UPDATE birthday.birthdays
+  SET next_occurrence = GREATEST(
+    birthdays.next_occurrence,
+    birthday.first_occurrence_since(
+      birthdays.m,
+      birthdays.d,
+      make_date(occurrences.year + 1, 1, 1)
+    )
+  )
+  FROM occurrences
+  JOIN queued
+    ON queued.user_id = occurrences.user_id
+  WHERE birthdays.id = occurrences.birthday_id
+)
+SELECT
+  (
+    SELECT count(*)
+    FROM queued
+  ),
+  (
+    SELECT count(DISTINCT postponed.user_id)
+    FROM postponed
+  )
+)";
+
+// SKIP LOCKED lets concurrent workers claim disjoint batches
+const std::string kClaimNotificationsQuery = R"(
+WITH claimed AS (
+  SELECT notification_outbox.id
+  FROM birthday.notification_outbox
+  WHERE notification_outbox.next_attempt_at <= now()
+  ORDER BY notification_outbox.next_attempt_at
+  LIMIT $1
+  FOR UPDATE SKIP LOCKED
+)
+UPDATE birthday.notification_outbox
+SET
+  attempts = notification_outbox.attempts + 1,
+  next_attempt_at = now() + make_interval(secs => $2)
+FROM claimed, birthday.users
+WHERE notification_outbox.id = claimed.id
+  AND users.id = notification_outbox.user_id
+RETURNING
+  notification_outbox.id,
+  users.chat_id,
+  notification_outbox.text,
+  notification_outbox.attempts
+)";
+
+const std::string kDeleteNotificationQuery = R"(
+DELETE
+FROM birthday.notification_outbox
+WHERE notification_outbox.id = $1
+)";
+
+const std::string kRescheduleNotificationQuery = R"(
+UPDATE birthday.notification_outbox
+SET next_attempt_at = now() + make_interval(secs => $2)
+WHERE notification_outbox.id = $1
+)";
+
+}  // namespace
+
+PlanResult PlanNotifications(
+    const cctz::civil_day& local_day,
+    const std::vector<models::PlannedNotification>& notifications,
+    userver::storages::postgres::Cluster& postgres) {
+  if (notifications.empty()) {
+    return {};
+  }
+
+  std::vector<models::BirthdayId> birthday_ids;
+  std::vector<models::BirthdayYear> years;
+  for (const auto& notification : notifications) {
+    UINVARIANT(notification.birthdays.size() ==
+                   notification.celebrate_today.size() +
+                       notification.forgotten.size(),
+               "Every occurrence of a notification must have a title");
+    for (const auto& occurrence : notification.birthdays) {
+      birthday_ids.push_back(occurrence.birthday_id);
+      years.push_back(occurrence.year);
+    }
+  }
+
+  // The ledger and the outbox change in a single transaction
+  auto transaction =
+      postgres.Begin(userver::storages::postgres::ClusterHostType::kMaster,
+                     userver::storages::postgres::Transaction::RW);
+  // a birthday has a single occurrence in a notification window
+  const auto recorded_ids =
+      transaction.Execute(kRecordOccurrencesQuery, birthday_ids, years)
+          .AsContainer<std::vector<models::BirthdayId>>();
+  const std::unordered_set<models::BirthdayId> recorded(recorded_ids.begin(),
+                                                        recorded_ids.end());
+
+  // one element per recorded occurrence
+  std::vector<models::UserId> user_ids;
+  std::vector<models::BirthdayId> recorded_birthday_ids;
+  std::vector<models::BirthdayYear> recorded_years;
+  // std::vector<bool> packs bits and has no postgres mapping, 0 or 1 is
+  // cast to BOOLEAN by the query
+  std::vector<int32_t> celebrate_today;
+  std::vector<std::string> titles;
+  for (const auto& notification : notifications) {
+    const auto today_count = notification.celebrate_today.size();
+    for (std::size_t i = 0; i < notification.birthdays.size(); ++i) {
+      const auto& occurrence = notification.birthdays[i];
+      if (!recorded.count(occurrence.birthday_id)) {
+        continue;
+      }
+      const bool today = i < today_count;
+      user_ids.push_back(notification.user_id);
+      recorded_birthday_ids.push_back(occurrence.birthday_id);
+      recorded_years.push_back(occurrence.year);
+      celebrate_today.push_back(today ? 1 : 0);
+      titles.push_back(today ? notification.celebrate_today[i]
+                             : notification.forgotten[i - today_count]);
+    }
+  }
+  if (user_ids.empty()) {
+    transaction.Commit();
+    return {};
+  }
+
+  const auto result =
+      transaction
+          .Execute(kQueueNotificationsQuery,
+                   fmt::format("{:04}-{:02}-{:02}", local_day.year(),
+                               local_day.month(), local_day.day()),
+                   user_ids, recorded_birthday_ids, recorded_years,
+                   celebrate_today, titles)
+          .AsSingleRow<PlanResult>(userver::storages::postgres::kRowTag);
+  transaction.Commit();
+  return result;
+}
+
+std::vector<models::OutboxNotification> ClaimNotifications(
+    const std::size_t limit, const std::chrono::seconds lease,
+    userver::storages::postgres::Cluster& postgres) {
+  return postgres
+      .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+               kClaimNotificationsQuery, static_cast<int64_t>(limit),
+               static_cast<double>(lease.count()))
+      .AsContainer<std::vector<models::OutboxNotification>>(
+          userver::storages::postgres::kRowTag);
+}
+
+void DeleteNotification(const models::NotificationId id,
+                        userver::storages::postgres::Cluster& postgres) {
+  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                   kDeleteNotificationQuery, id);
+}
+
+void RescheduleNotification(const models::NotificationId id,
+                            const std::chrono::seconds delay,
+                            userver::storages::postgres::Cluster& postgres) {
+  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                   kRescheduleNotificationQuery, id,
+                   static_cast<double>(delay.count()));
+}
+
+}  // namespace telegram_bot::db
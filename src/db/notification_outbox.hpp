@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <cctz/civil_time.h>
+
+#include <userver/storages/postgres/postgres_fwd.hpp>
+
+#include <models/notification.hpp>
+
+namespace telegram_bot::db {
+
+struct PlanResult {
+  int64_t queued_users{};
+  // the notification of the user for the day is being sent, the occurrences
+  // are left out of the ledger to be planned again
+  int64_t postponed_users{};
+};
+
+// Puts occurrences of the birthdays into the notifications ledger and
+// notifications with new occurrences into the outbox, the texts mention only
+// the new occurrences, replays are no-ops. Occurrences of deleted birthdays
+// are skipped.
+PlanResult PlanNotifications(
+    const cctz::civil_day& local_day,
+    const std::vector<models::PlannedNotification>& notifications,
+    userver::storages::postgres::Cluster& postgres);
+
+// Claimed notifications are hidden from other workers for the lease duration
+// and come back if they are neither deleted nor rescheduled in time
+std::vector<models::OutboxNotification> ClaimNotifications(
+    std::size_t limit, std::chrono::seconds lease,
+    userver::storages::postgres::Cluster& postgres);
+
+void DeleteNotification(models::NotificationId id,
+                        userver::storages::postgres::Cluster& postgres);
+
+// Hides the notification for the delay, also renews the lease of a claimed one
+void RescheduleNotification(models::NotificationId id,
+                            std::chrono::seconds delay,
+                            userver::storages::postgres::Cluster& postgres);
+
+}  // namespace telegram_bot::db
@@ -12,22 +12,74 @@ const std::string kInsertUserQuery = R"(
 INSERT
 INTO birthday.users (chat_id)
 VALUES ($1)
+ON CONFLICT (chat_id) DO NOTHING
 )";
 
 const std::string kFindUserByChatIdQuery = R"(
 SELECT
   users.id,
-  users.chat_id
+  users.chat_id,
+  users.timezone,
+  to_char(users.notification_time, 'HH24:MI')
 FROM birthday.users
 WHERE users.chat_id = $1
 )";
 
-const std::string kFindUserById = R"(
+const std::string kUpdateTimezoneQuery = R"(
+UPDATE birthday.users
+SET timezone = $2
+WHERE users.id = $1
+)";
+
+const std::string kUpdateNotificationTimeQuery = R"(
+UPDATE birthday.users
+SET notification_time = $2::TIME
+WHERE users.id = $1
+)";
+
+// Skip scan over users_notification_bucket_idx, every step jumps to the next
+// bucket, so only a few users of every bucket are read
+const std::string kNotificationBucketsQuery = R"(
+WITH RECURSIVE buckets AS (
+  (
+    SELECT users.notification_bucket
+    FROM birthday.users
+    ORDER BY users.notification_bucket
+    LIMIT 1
+  )
+  UNION ALL
+  SELECT (
+    SELECT users.notification_bucket
+    FROM birthday.users
+    WHERE users.notification_bucket > buckets.notification_bucket
+    ORDER BY users.notification_bucket
+    LIMIT 1
+  )
+  FROM buckets
+  WHERE buckets.notification_bucket IS NOT NULL
+)
 SELECT
-  users.id,
-  users.chat_id
+  shard_user.timezone,
+  to_char(shard_user.notification_time, 'HH24:MI')
+FROM buckets
+JOIN LATERAL (
+  SELECT
+    users.timezone,
+    users.notification_time
+  FROM birthday.users
+  WHERE users.notification_bucket = buckets.notification_bucket
+    AND users.id % $1 = $2
+  LIMIT 1
+) AS shard_user
+  ON true
+)";
+
+const std::string kUsersNotificationBucketsQuery = R"(
+SELECT DISTINCT
+  users.timezone,
+  to_char(users.notification_time, 'HH24:MI')
 FROM birthday.users
-WHERE users.id = $1
+WHERE users.id = ANY($1)
 )";
 
 const std::string kDeleteUserQuery = R"(
@@ -36,20 +88,17 @@ FROM birthday.users
 WHERE users.id = $1
 )";
 
-struct Row {
-  models::UserId id{};
-  models::ChatId chat_id{};
-};
-
 }  // namespace
 
-void InsertUser(const models::ChatId chat_id,
+bool InsertUser(const models::ChatId chat_id,
                 userver::storages::postgres::Cluster& postgres) {
-  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
-                   kInsertUserQuery, chat_id);
+  return postgres
+             .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                      kInsertUserQuery, chat_id)
+             .RowsAffected() > 0;
 }
 
-std::optional<models::UserId> FindUser(
+std::optional<models::User> FindUser(
     const models::ChatId chat_id,
     userver::storages::postgres::Cluster& postgres) {
   const auto rows =
@@ -58,23 +107,55 @@ std::optional<models::UserId> FindUser(
   if (rows.IsEmpty()) {
     return std::nullopt;
   }
-  const auto row = rows.AsSingleRow<Row>(userver::storages::postgres::kRowTag);
-  return row.id;
+  return rows.AsSingleRow<models::User>(userver::storages::postgres::kRowTag);
 }
 
-models::ChatId GetChatId(const models::UserId user_id,
-                         userver::storages::postgres::Cluster& postgres) {
-  const auto rows =
-      postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
-                       kFindUserById, user_id);
-  const auto row = rows.AsSingleRow<Row>(userver::storages::postgres::kRowTag);
-  return row.chat_id;
+bool UpdateTimezone(const models::UserId user_id,
+                    const std::optional<std::string>& timezone,
+                    userver::storages::postgres::Cluster& postgres) {
+  return postgres
+             .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                      kUpdateTimezoneQuery, user_id, timezone)
+             .RowsAffected() > 0;
+}
+
+bool UpdateNotificationTime(
+    const models::UserId user_id,
+    const std::optional<std::string>& notification_time_of_day,
+    userver::storages::postgres::Cluster& postgres) {
+  return postgres
+             .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                      kUpdateNotificationTimeQuery, user_id,
+                      notification_time_of_day)
+             .RowsAffected() > 0;
+}
+
+std::vector<models::NotificationBucket> FetchNotificationBuckets(
+    const models::UserShard& shard,
+    userver::storages::postgres::Cluster& postgres) {
+  return postgres
+      .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+               kNotificationBucketsQuery, shard.count, shard.index)
+      .AsContainer<std::vector<models::NotificationBucket>>(
+          userver::storages::postgres::kRowTag);
+}
+
+std::vector<models::NotificationBucket> FetchNotificationBuckets(
+    const std::vector<models::UserId>& user_ids,
+    userver::storages::postgres::Cluster& postgres) {
+  return postgres
+      .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+               kUsersNotificationBucketsQuery, user_ids)
+      .AsContainer<std::vector<models::NotificationBucket>>(
+          userver::storages::postgres::kRowTag);
 }
 
-void DeleteUser(const models::UserId user_id,
+bool DeleteUser(const models::UserId user_id,
                 userver::storages::postgres::Cluster& postgres) {
-  postgres.Execute(userver::storages::postgres::ClusterHostType::kMaster,
-                   kDeleteUserQuery, user_id);
+  return postgres
+             .Execute(userver::storages::postgres::ClusterHostType::kMaster,
+                      kDeleteUserQuery, user_id)
+             .RowsAffected() > 0;
 }
 
 }  // namespace telegram_bot::db
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <optional>
+#include <string>
+#include <vector>
 
 #include <userver/storages/postgres/postgres_fwd.hpp>
 
@@ -8,16 +10,38 @@
 
 namespace telegram_bot::db {
 
-void InsertUser(models::ChatId chat_id,
+// Returns false if the chat is registered already
+bool InsertUser(models::ChatId chat_id,
                 userver::storages::postgres::Cluster& postgres);
 
-std::optional<models::UserId> FindUser(
+std::optional<models::User> FindUser(
     models::ChatId chat_id, userver::storages::postgres::Cluster& postgres);
 
-models::ChatId GetChatId(models::UserId user_id,
-                         userver::storages::postgres::Cluster& postgres);
-
-void DeleteUser(models::UserId user_id,
+// std::nullopt resets the value to the default of the service, returns false
+// if the user is missing
+bool UpdateTimezone(models::UserId user_id,
+                    const std::optional<std::string>& timezone,
+                    userver::storages::postgres::Cluster& postgres);
+
+// std::nullopt resets the value to the default of the service, returns false
+// if the user is missing
+bool UpdateNotificationTime(
+    models::UserId user_id,
+    const std::optional<std::string>& notification_time_of_day,
+    userver::storages::postgres::Cluster& postgres);
+
+// Distinct notification settings of the shard users
+std::vector<models::NotificationBucket> FetchNotificationBuckets(
+    const models::UserShard& shard,
+    userver::storages::postgres::Cluster& postgres);
+
+// Distinct notification settings of the users
+std::vector<models::NotificationBucket> FetchNotificationBuckets(
+    const std::vector<models::UserId>& user_ids,
+    userver::storages::postgres::Cluster& postgres);
+
+// Returns false if the user is missing
+bool DeleteUser(models::UserId user_id,
                 userver::storages::postgres::Cluster& postgres);
 
 }  // namespace telegram_bot::db
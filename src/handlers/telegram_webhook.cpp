@@ -0,0 +1,42 @@
+#include "telegram_webhook.hpp"
+
+#include <exception>
+
+#include <userver/components/component_context.hpp>
+#include <userver/logging/log.hpp>
+#include <userver/server/handlers/exceptions.hpp>
+
+namespace telegram_bot::handlers {
+
+namespace {
+
+const std::string kSecretTokenHeader = "X-Telegram-Bot-Api-Secret-Token";
+
+}  // namespace
+
+TelegramWebhook::TelegramWebhook(
+    const userver::components::ComponentConfig& config,
+    const userver::components::ComponentContext& context)
+    : HttpHandlerBase(config, context),
+      bot_(context.FindComponent<components::bot::Component>()) {}
+
+std::string TelegramWebhook::HandleRequestThrow(
+    const userver::server::http::HttpRequest& request,
+    userver::server::request::RequestContext&) const {
+  if (!bot_.IsValidWebhookSecret(request.GetHeader(kSecretTokenHeader))) {
+    throw userver::server::handlers::Unauthorized(
+        userver::server::handlers::ExternalBody{"Invalid secret token"});
+  }
+
+  try {
+    bot_.HandleUpdate(request.RequestBody());
+  } catch (const std::exception& exc) {
+    // telegram sends an update again until it is accepted, a malformed one
+    // would be retried in vain
+    LOG_WARNING() << "Malformed update, skip it: " << exc;
+  }
+  // telegram ignores the body of a successful response
+  return {};
+}
+
+}  // namespace telegram_bot::handlers
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include <userver/components/component_fwd.hpp>
+#include <userver/server/handlers/http_handler_base.hpp>
+
+#include <components/bot/component.hpp>
+
+namespace telegram_bot::handlers {
+
+// Accepts updates pushed by telegram when the bot runs with webhook_url,
+// replicas behind a balancer share the incoming updates
+class TelegramWebhook final
+    : public userver::server::handlers::HttpHandlerBase {
+ public:
+  static constexpr std::string_view kName = "handler-telegram-webhook";
+
+  TelegramWebhook(const userver::components::ComponentConfig& config,
+                  const userver::components::ComponentContext& context);
+
+  std::string HandleRequestThrow(
+      const userver::server::http::HttpRequest& request,
+      userver::server::request::RequestContext& context) const override;
+
+ private:
+  const components::bot::Component& bot_;
+};
+
+}  // namespace telegram_bot::handlers
@@ -11,7 +11,11 @@
 #include <userver/utils/daemon_run.hpp>
 
 #include <components/birthday_notificator.hpp>
+#include <components/birthdays_cache.hpp>
 #include <components/bot/component.hpp>
+#include <components/notification_sender.hpp>
+#include <components/users_cache.hpp>
+#include <handlers/telegram_webhook.hpp>
 
 int main(int argc, char* argv[]) {
   auto component_list =
@@ -26,7 +30,11 @@ int main(int argc, char* argv[]) {
           .Append<userver::server::handlers::ServerMonitor>()
           .Append<userver::server::handlers::TestsControl>()
           .Append<telegram_bot::components::BirthdayNotificator>()
-          .Append<telegram_bot::components::bot::Component>();
+          .Append<telegram_bot::components::BirthdaysCache>()
+          .Append<telegram_bot::components::bot::Component>()
+          .Append<telegram_bot::components::NotificationSender>()
+          .Append<telegram_bot::components::UsersCache>()
+          .Append<telegram_bot::handlers::TelegramWebhook>();
 
   return userver::utils::DaemonMain(argc, argv, component_list);
 }
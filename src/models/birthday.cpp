@@ -1,9 +1,18 @@
 #include "birthday.hpp"
 
+#include <array>
 #include <chrono>
 
 namespace telegram_bot::models {
 
+namespace {
+
+// Days before the month in a leap year
+const std::array<int, 12> kMonthOffsets = {0,   31,  60,  91,  121, 152,
+                                           182, 213, 244, 274, 305, 335};
+
+}  // namespace
+
 bool IsValidDate(const std::optional<BirthdayYear> y, const BirthdayMonth m,
                  const BirthdayDay d) {
   if (m.GetUnderlying() < 0 || d.GetUnderlying() < 0) {
@@ -24,4 +33,8 @@ bool IsValidDate(const std::optional<BirthdayYear> y, const BirthdayMonth m,
   return date.ok();
 }
 
+int GetDayOfLeapYear(const BirthdayMonth m, const BirthdayDay d) {
+  return kMonthOffsets[m.GetUnderlying() - 1] + d.GetUnderlying() - 1;
+}
+
 }  // namespace telegram_bot::models
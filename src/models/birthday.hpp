@@ -1,11 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <optional>
 #include <string>
 
 #include <userver/utils/strong_typedef.hpp>
 
-#include <models/time_point.hpp>
 #include <models/user.hpp>
 
 namespace telegram_bot::models {
@@ -23,10 +23,36 @@ struct Birthday {
   BirthdayMonth m{};
   BirthdayDay d{};
   bool notification_enabled{};
-  std::optional<TimePoint> last_notification_time;
+  // year of the last occurrence the user was notified about
+  std::optional<BirthdayYear> last_notified_year;
   UserId user_id{};
 };
 
+// Birthday with settings of its user as loaded by the birthdays cache, deleted
+// birthdays are loaded as tombstones to be removed from the cache
+struct CalendarBirthday {
+  BirthdayId id{};
+  std::string person;
+  std::optional<BirthdayYear> y{};
+  BirthdayMonth m{};
+  BirthdayDay d{};
+  bool notification_enabled{};
+  // year of the last occurrence the user was notified about
+  std::optional<BirthdayYear> last_notified_year;
+  UserId user_id{};
+  std::optional<std::string> timezone;
+  std::optional<std::string> notification_time_of_day;
+  bool is_deleted{};
+};
+
 bool IsValidDate(std::optional<BirthdayYear> y, BirthdayMonth m, BirthdayDay d);
 
+inline constexpr int kDaysInLeapYear = 366;
+
+// Birthdays missed for this long are still notified as forgotten ones
+inline constexpr std::chrono::days kForgottenBirthdaySearchDistance{3};
+
+// Zero-based day of a leap year, keeps Feb 29 apart from Mar 1
+int GetDayOfLeapYear(BirthdayMonth m, BirthdayDay d);
+
 }  // namespace telegram_bot::models
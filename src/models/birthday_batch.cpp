@@ -0,0 +1,29 @@
+#include "birthday_batch.hpp"
+
+#include <algorithm>
+
+#include <userver/utils/assert.hpp>
+
+namespace telegram_bot::models {
+
+BirthdayBatch::BirthdayBatch(const std::size_t records_capacity,
+                             const std::size_t names_capacity)
+    : names_(std::make_unique_for_overwrite<char[]>(names_capacity)),
+      names_capacity_(names_capacity) {
+  records_.reserve(records_capacity);
+}
+
+void BirthdayBatch::Append(const Record& record) {
+  UINVARIANT(records_.size() < records_.capacity() &&
+                 names_size_ + record.person.size() <= names_capacity_,
+             "Birthday batch overflow");
+
+  auto* name = names_.get() + names_size_;
+  std::copy(record.person.begin(), record.person.end(), name);
+  names_size_ += record.person.size();
+
+  records_.push_back(record);
+  records_.back().person = std::string_view{name, record.person.size()};
+}
+
+}  // namespace telegram_bot::models
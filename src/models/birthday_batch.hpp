@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <models/birthday.hpp>
+
+namespace telegram_bot::models {
+
+// Birthdays decoded in bulk, names of all rows share a single buffer so that a
+// batch costs a couple of allocations whatever its size
+class BirthdayBatch final {
+ public:
+  // Same fields as Birthday, person points into the batch
+  struct Record {
+    BirthdayId id{};
+    std::string_view person;
+    std::optional<BirthdayYear> y{};
+    BirthdayMonth m{};
+    BirthdayDay d{};
+    bool notification_enabled{};
+    std::optional<BirthdayYear> last_notified_year;
+    UserId user_id{};
+  };
+  static_assert(std::is_trivially_copyable_v<Record>);
+
+  BirthdayBatch() = default;
+  // Reserves space for records and names, appending more is a programming
+  // error
+  BirthdayBatch(std::size_t records_capacity, std::size_t names_capacity);
+
+  BirthdayBatch(BirthdayBatch&&) noexcept = default;
+  BirthdayBatch& operator=(BirthdayBatch&&) noexcept = default;
+
+  // Copies the name of the record into the batch
+  void Append(const Record& record);
+
+  std::size_t size() const { return records_.size(); }
+  bool empty() const { return records_.empty(); }
+  const Record& operator[](std::size_t index) const { return records_[index]; }
+  const Record& back() const { return records_.back(); }
+  auto begin() const { return records_.begin(); }
+  auto end() const { return records_.end(); }
+
+  std::size_t GetNamesSize() const { return names_size_; }
+
+ private:
+  std::unique_ptr<char[]> names_;
+  std::size_t names_size_{0};
+  std::size_t names_capacity_{0};
+  std::vector<Record> records_;
+};
+
+}  // namespace telegram_bot::models
@@ -0,0 +1,36 @@
+#include "birthday_batch.hpp"
+
+#include <string>
+
+#include <userver/utest/utest.hpp>
+
+using telegram_bot::models::BirthdayBatch;
+using telegram_bot::models::BirthdayId;
+using telegram_bot::models::UserId;
+
+namespace {
+
+BirthdayBatch::Record MakeRecord(int id, std::string_view person, int user_id) {
+  BirthdayBatch::Record record;
+  record.id = BirthdayId{id};
+  record.person = person;
+  record.user_id = UserId{user_id};
+  return record;
+}
+
+}  // namespace
+
+TEST(BirthdayBatch, NamesAreCopied) {
+  BirthdayBatch batch(2, 10);
+  {
+    std::string name = "Alice";
+    batch.Append(MakeRecord(1, name, 1));
+    name = "Bobby";
+    batch.Append(MakeRecord(2, name, 2));
+  }
+
+  ASSERT_EQ(batch.size(), 2);
+  EXPECT_EQ(batch[0].person, "Alice");
+  EXPECT_EQ(batch[1].person, "Bobby");
+  EXPECT_EQ(batch.GetNamesSize(), 10);
+}
@@ -0,0 +1,22 @@
+#include "birthday.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+void BM_IsValidDate(benchmark::State& state) {
+  int day = 0;
+  for (auto _ : state) {
+    std::optional<telegram_bot::models::BirthdayYear> y;
+    if (day % 2 == 0) {
+      y = telegram_bot::models::BirthdayYear{1970 + day % 60};
+    }
+    benchmark::DoNotOptimize(telegram_bot::models::IsValidDate(
+        y, telegram_bot::models::BirthdayMonth{day % 13},
+        telegram_bot::models::BirthdayDay{day % 32}));
+    ++day;
+  }
+}
+BENCHMARK(BM_IsValidDate);
+
+}  // namespace
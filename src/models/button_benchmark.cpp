@@ -0,0 +1,29 @@
+#include "button.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+const telegram_bot::models::Button kButton{
+    "person on 15.03", telegram_bot::models::ButtonType::kDeleteBirthday,
+    telegram_bot::models::ButtonContext::kNextBirthdaysEditBirthday,
+    telegram_bot::models::BirthdayId{123456}};
+
+void BM_SerializeButton(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(telegram_bot::models::SerializedButton{kButton});
+  }
+}
+BENCHMARK(BM_SerializeButton);
+
+void BM_ParseButtonData(benchmark::State& state) {
+  const telegram_bot::models::SerializedButton serialized{kButton};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        telegram_bot::models::ButtonData::FromBase64Serialized(
+            serialized.data));
+  }
+}
+BENCHMARK(BM_ParseButtonData);
+
+}  // namespace
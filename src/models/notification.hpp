@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <userver/utils/strong_typedef.hpp>
+
+#include <models/birthday.hpp>
+#include <models/user.hpp>
+
+namespace telegram_bot::models {
+
+using NotificationId =
+    userver::utils::StrongTypedef<class NotificationIdTag, int64_t>;
+
+// Key of the notifications ledger, the year a birthday is celebrated in
+struct BirthdayOccurrence {
+  BirthdayId birthday_id{};
+  BirthdayYear year{};
+};
+
+// Notification of a user to be put into the outbox, its text mentions only
+// the occurrences which were not in the ledger yet
+struct PlannedNotification {
+  UserId user_id{};
+  // occurrences of celebrate_today go first, then the ones of forgotten
+  std::vector<BirthdayOccurrence> birthdays;
+  // persons
+  std::vector<std::string> celebrate_today;
+  // persons with the days
+  std::vector<std::string> forgotten;
+};
+
+// Notification claimed from the outbox for delivery
+struct OutboxNotification {
+  NotificationId id{};
+  ChatId chat_id{};
+  std::string text;
+  // including the current one
+  int32_t attempts{};
+};
+
+}  // namespace telegram_bot::models
@@ -0,0 +1,12 @@
+#include "user.hpp"
+
+#include <fmt/format.h>
+
+namespace telegram_bot::models {
+
+std::string NotificationBucket::GetKey() const {
+  return fmt::format("{}|{}", timezone.value_or(""),
+                     notification_time_of_day.value_or(""));
+}
+
+}  // namespace telegram_bot::models
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <optional>
+#include <string>
+
 #include <userver/utils/strong_typedef.hpp>
 
 namespace telegram_bot::models {
@@ -10,6 +13,25 @@ using ChatId = userver::utils::StrongTypedef<class ChatIdTag, int64_t>;
 struct User {
   UserId id;
   ChatId chat_id;
+  // unset values are defaults of the service
+  std::optional<std::string> timezone;
+  // HH:MM
+  std::optional<std::string> notification_time_of_day;
+};
+
+// Users with the same settings are notified at the same time
+struct NotificationBucket {
+  std::optional<std::string> timezone;
+  std::optional<std::string> notification_time_of_day;
+
+  // The same as users.notification_bucket of the bucket users
+  std::string GetKey() const;
+};
+
+// Users are split into shards by user_id modulo count
+struct UserShard {
+  int32_t index{0};
+  int32_t count{1};
 };
 
 }  // namespace telegram_bot::models
@@ -0,0 +1,75 @@
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <cctz/time_zone.h>
+
+#include <userver/utils/datetime.hpp>
+
+#include <simulator/simulation.hpp>
+
+namespace {
+
+const std::string_view kUsage =
+    "Usage: telegram_bot_simulator SNAPSHOT_CSV [--year YEAR] "
+    "[--timezone DEFAULT_TIMEZONE] [--time DEFAULT_TIME_OF_DAY]\n"
+    "Simulates notifications of a year over a snapshot of birthdays, see "
+    "src/simulator/simulation.hpp for the snapshot export\n";
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string snapshot_path;
+  std::string year = cctz::format(
+      "%Y", userver::utils::datetime::Now(), cctz::utc_time_zone());
+  std::string timezone = "Europe/Moscow";
+  std::string time_of_day = "10:00";
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help") {
+      std::cout << kUsage;
+      return 0;
+    }
+    if ((arg == "--year" || arg == "--timezone" || arg == "--time") &&
+        i + 1 < argc) {
+      auto& value = arg == "--year" ? year
+                    : arg == "--timezone" ? timezone
+                                          : time_of_day;
+      value = argv[++i];
+    } else if (snapshot_path.empty() && !arg.starts_with("--")) {
+      snapshot_path = arg;
+    } else {
+      std::cerr << kUsage;
+      return 1;
+    }
+  }
+  if (snapshot_path.empty()) {
+    std::cerr << kUsage;
+    return 1;
+  }
+
+  try {
+    telegram_bot::simulator::SimulationSettings settings{
+        std::stoi(year),
+        {},
+        userver::utils::datetime::TimeOfDay<std::chrono::minutes>(
+            time_of_day)};
+    if (!cctz::load_time_zone(timezone, &settings.default_timezone)) {
+      throw std::runtime_error("Unknown timezone " + timezone);
+    }
+
+    std::ifstream input(snapshot_path);
+    if (!input) {
+      throw std::runtime_error("Failed to open " + snapshot_path);
+    }
+    const auto snapshot = telegram_bot::simulator::ReadSnapshot(input);
+    telegram_bot::simulator::WriteReport(
+        telegram_bot::simulator::Simulate(snapshot, settings), std::cout);
+  } catch (const std::exception& exc) {
+    std::cerr << exc.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
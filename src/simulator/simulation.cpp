@@ -0,0 +1,252 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <components/birthday_notificator.hpp>
+
+namespace telegram_bot::simulator {
+
+namespace {
+
+const std::size_t kSnapshotColumns = 9;
+
+// Unquoted empty fields are NULLs as in the psql CSV format
+std::vector<std::optional<std::string>> SplitCsvLine(const std::string& line) {
+  std::vector<std::optional<std::string>> fields;
+  std::string field;
+  bool quoted = false;
+  bool in_quotes = false;
+  for (std::size_t i = 0; i < line.size(); ++i) {
+    const char c = line[i];
+    if (in_quotes) {
+      if (c != '"') {
+        field += c;
+      } else if (i + 1 < line.size() && line[i + 1] == '"') {
+        field += '"';
+        ++i;
+      } else {
+        in_quotes = false;
+      }
+    } else if (c == '"') {
+      quoted = in_quotes = true;
+    } else if (c == ',') {
+      fields.push_back(field.empty() && !quoted
+                           ? std::nullopt
+                           : std::make_optional(std::move(field)));
+      field.clear();
+      quoted = false;
+    } else {
+      field += c;
+    }
+  }
+  if (in_quotes) {
+    throw std::runtime_error("Unterminated quote");
+  }
+  fields.push_back(field.empty() && !quoted
+                       ? std::nullopt
+                       : std::make_optional(std::move(field)));
+  return fields;
+}
+
+const std::string& GetRequired(const std::optional<std::string>& field) {
+  if (!field.has_value()) {
+    throw std::runtime_error("Unexpected NULL");
+  }
+  return *field;
+}
+
+int ParseInt(const std::optional<std::string>& field) {
+  const auto& value = GetRequired(field);
+  std::size_t parsed = 0;
+  const auto result = std::stoi(value, &parsed);
+  if (parsed != value.size()) {
+    throw std::runtime_error("Invalid integer " + value);
+  }
+  return result;
+}
+
+bool ParseBool(const std::optional<std::string>& field) {
+  const auto& value = GetRequired(field);
+  if (value == "t" || value == "true") {
+    return true;
+  }
+  if (value == "f" || value == "false") {
+    return false;
+  }
+  throw std::runtime_error("Invalid boolean " + value);
+}
+
+models::CalendarBirthday ParseSnapshotLine(const std::string& line) {
+  const auto fields = SplitCsvLine(line);
+  if (fields.size() != kSnapshotColumns) {
+    throw std::runtime_error(fmt::format("Expected {} columns, got {}",
+                                         kSnapshotColumns, fields.size()));
+  }
+
+  models::CalendarBirthday birthday;
+  birthday.id = models::BirthdayId{ParseInt(fields[0])};
+  birthday.person = GetRequired(fields[1]);
+  if (fields[2].has_value()) {
+    birthday.y = models::BirthdayYear{ParseInt(fields[2])};
+  }
+  birthday.m = models::BirthdayMonth{ParseInt(fields[3])};
+  birthday.d = models::BirthdayDay{ParseInt(fields[4])};
+  birthday.notification_enabled = ParseBool(fields[5]);
+  birthday.user_id = models::UserId{ParseInt(fields[6])};
+  birthday.timezone = fields[7];
+  birthday.notification_time_of_day = fields[8];
+  if (!models::IsValidDate(birthday.y, birthday.m, birthday.d)) {
+    throw std::runtime_error("Invalid date");
+  }
+  return birthday;
+}
+
+// Users sharing notification settings, the notificator processes them at
+// once
+struct Bucket {
+  cctz::time_zone timezone;
+  userver::utils::datetime::TimeOfDay<std::chrono::minutes> time_of_day;
+  std::vector<models::Birthday> rows;
+  std::unordered_map<models::BirthdayId, std::size_t> row_indexes;
+};
+
+using BucketKey =
+    std::pair<std::optional<std::string>, std::optional<std::string>>;
+
+Bucket MakeBucket(const BucketKey& key, const SimulationSettings& settings) {
+  Bucket bucket{settings.default_timezone, settings.default_time_of_day, {},
+                {}};
+  if (key.first.has_value() &&
+      !cctz::load_time_zone(*key.first, &bucket.timezone)) {
+    throw std::runtime_error("Unknown timezone " + *key.first);
+  }
+  if (key.second.has_value()) {
+    bucket.time_of_day =
+        userver::utils::datetime::TimeOfDay<std::chrono::minutes>(*key.second);
+  }
+  return bucket;
+}
+
+std::string FormatDay(const cctz::civil_day& day) {
+  return fmt::format("{:04}-{:02}-{:02}", day.year(), day.month(), day.day());
+}
+
+}  // namespace
+
+std::vector<models::CalendarBirthday> ReadSnapshot(std::istream& input) {
+  std::vector<models::CalendarBirthday> snapshot;
+  std::string line;
+  std::size_t line_number = 0;
+  while (std::getline(input, line)) {
+    ++line_number;
+    if (line.empty()) {
+      continue;
+    }
+    try {
+      snapshot.push_back(ParseSnapshotLine(line));
+    } catch (const std::exception& exc) {
+      throw std::runtime_error(
+          fmt::format("Snapshot line {}: {}", line_number, exc.what()));
+    }
+  }
+  return snapshot;
+}
+
+SimulationReport Simulate(const std::vector<models::CalendarBirthday>& snapshot,
+                          const SimulationSettings& settings) {
+  std::map<BucketKey, Bucket> buckets;
+  for (const auto& birthday : snapshot) {
+    const BucketKey key{birthday.timezone, birthday.notification_time_of_day};
+    auto it = buckets.find(key);
+    if (it == buckets.end()) {
+      it = buckets.emplace(key, MakeBucket(key, settings)).first;
+    }
+    auto& bucket = it->second;
+    bucket.row_indexes.emplace(birthday.id, bucket.rows.size());
+    bucket.rows.push_back({birthday.id, birthday.person, birthday.y,
+                           birthday.m, birthday.d,
+                           birthday.notification_enabled,
+                           models::BirthdayYear{settings.year - 1},
+                           birthday.user_id});
+  }
+
+  SimulationReport report;
+  for (cctz::civil_day day(settings.year, 1, 1); day.year() == settings.year;
+       ++day) {
+    DayReport day_report{day, 0, 0, {}};
+    for (auto& [key, bucket] : buckets) {
+      const auto start = std::chrono::steady_clock::now();
+      const auto birthdays_to_notify =
+          components::impl::FindBirthdaysToNotify(bucket.rows, day);
+      day_report.compute_time +=
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start);
+      if (birthdays_to_notify.empty()) {
+        continue;
+      }
+
+      const auto users = static_cast<int64_t>(birthdays_to_notify.size());
+      day_report.users += users;
+      report.users_per_minute[components::impl::GetNotificationTime(
+          day, bucket.time_of_day, bucket.timezone)] += users;
+      // as the notifications ledger does
+      for (const auto& [user_id, birthdays] : birthdays_to_notify) {
+        day_report.birthdays +=
+            static_cast<int64_t>(birthdays.occurrences.size());
+        for (const auto& occurrence : birthdays.occurrences) {
+          bucket.rows[bucket.row_indexes.at(occurrence.birthday_id)]
+              .last_notified_year = occurrence.year;
+        }
+      }
+    }
+    report.compute_time += day_report.compute_time;
+    report.days.push_back(day_report);
+  }
+  return report;
+}
+
+void WriteReport(const SimulationReport& report, std::ostream& output) {
+  output << "day,users,birthdays,compute_us\n";
+  for (const auto& day : report.days) {
+    output << fmt::format("{},{},{},{}\n", FormatDay(day.day), day.users,
+                          day.birthdays, day.compute_time.count());
+  }
+
+  output << "\nminute_utc,users\n";
+  for (const auto& [minute, users] : report.users_per_minute) {
+    output << fmt::format(
+        "{},{}\n",
+        cctz::format("%Y-%m-%dT%H:%MZ", minute, cctz::utc_time_zone()), users);
+  }
+
+  output << '\n';
+  const auto busiest_day = std::max_element(
+      report.days.begin(), report.days.end(),
+      [](const DayReport& lhs, const DayReport& rhs) {
+        return lhs.users < rhs.users;
+      });
+  if (busiest_day != report.days.end()) {
+    output << fmt::format("busiest day: {}, {} users\n",
+                          FormatDay(busiest_day->day), busiest_day->users);
+  }
+  const auto busiest_minute = std::max_element(
+      report.users_per_minute.begin(), report.users_per_minute.end(),
+      [](const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; });
+  if (busiest_minute != report.users_per_minute.end()) {
+    output << fmt::format(
+        "busiest minute: {}, {} users\n",
+        cctz::format("%Y-%m-%dT%H:%MZ", busiest_minute->first,
+                     cctz::utc_time_zone()),
+        busiest_minute->second);
+  }
+  output << fmt::format("compute time: {} us\n", report.compute_time.count());
+}
+
+}  // namespace telegram_bot::simulator
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include <cctz/civil_time.h>
+#include <cctz/time_zone.h>
+
+#include <userver/utils/time_of_day.hpp>
+
+#include <models/birthday.hpp>
+#include <models/time_point.hpp>
+
+namespace telegram_bot::simulator {
+
+// Reads a snapshot of birthdays with settings of their users exported by
+//   \copy (SELECT birthdays.id, birthdays.person, birthdays.y, birthdays.m,
+//   birthdays.d, birthdays.notification_enabled, birthdays.user_id,
+//   users.timezone, to_char(users.notification_time, 'HH24:MI')
+//   FROM birthday.birthdays JOIN birthday.users
+//   ON users.id = birthdays.user_id) TO 'birthdays.csv' CSV
+// throws on malformed lines
+std::vector<models::CalendarBirthday> ReadSnapshot(std::istream& input);
+
+struct SimulationSettings {
+  int year{};
+  // defaults for users without settings of their own
+  cctz::time_zone default_timezone;
+  userver::utils::datetime::TimeOfDay<std::chrono::minutes>
+      default_time_of_day;
+};
+
+struct DayReport {
+  cctz::civil_day day;
+  int64_t users{};
+  int64_t birthdays{};
+  std::chrono::microseconds compute_time{};
+};
+
+struct SimulationReport {
+  std::vector<DayReport> days;
+  // users notified at a minute, all users of a notification bucket are
+  // planned at once
+  std::map<models::TimePoint, int64_t> users_per_minute;
+  std::chrono::microseconds compute_time{};
+};
+
+// Runs the notificator filter for every day of the year as if it was run at
+// the notification time of every bucket. Occurrences of the previous year are
+// treated as notified, so the first days do not catch up on old birthdays.
+SimulationReport Simulate(const std::vector<models::CalendarBirthday>& snapshot,
+                          const SimulationSettings& settings);
+
+// Per day and per minute histograms in CSV followed by a summary
+void WriteReport(const SimulationReport& report, std::ostream& output);
+
+}  // namespace telegram_bot::simulator
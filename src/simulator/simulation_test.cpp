@@ -0,0 +1,73 @@
+#include "simulation.hpp"
+
+#include <sstream>
+
+#include <userver/utest/utest.hpp>
+#include <userver/utils/datetime.hpp>
+
+using telegram_bot::simulator::ReadSnapshot;
+using telegram_bot::simulator::SimulationSettings;
+using telegram_bot::simulator::Simulate;
+
+namespace {
+
+SimulationSettings MakeSettings(int year) {
+  SimulationSettings settings{
+      year,
+      {},
+      userver::utils::datetime::TimeOfDay<std::chrono::minutes>("10:00")};
+  EXPECT_TRUE(
+      cctz::load_time_zone("Europe/Moscow", &settings.default_timezone));
+  return settings;
+}
+
+}  // namespace
+
+TEST(Simulation, ReadSnapshot) {
+  std::istringstream input(
+      "1,\"Smith, John\",1990,3,1,t,10,,\n"
+      "2,\"say \"\"hi\"\"\",,2,29,f,11,Asia/Vladivostok,09:30\n");
+  const auto snapshot = ReadSnapshot(input);
+  ASSERT_EQ(snapshot.size(), 2);
+  EXPECT_EQ(snapshot[0].person, "Smith, John");
+  EXPECT_EQ(snapshot[0].y->GetUnderlying(), 1990);
+  EXPECT_TRUE(snapshot[0].notification_enabled);
+  EXPECT_EQ(snapshot[0].timezone, std::nullopt);
+  EXPECT_EQ(snapshot[1].person, "say \"hi\"");
+  EXPECT_EQ(snapshot[1].y, std::nullopt);
+  EXPECT_FALSE(snapshot[1].notification_enabled);
+  EXPECT_EQ(snapshot[1].timezone, "Asia/Vladivostok");
+  EXPECT_EQ(snapshot[1].notification_time_of_day, "09:30");
+
+  std::istringstream invalid("1,person,,2,30,t,10,,\n");
+  EXPECT_THROW(ReadSnapshot(invalid), std::runtime_error);
+}
+
+TEST(Simulation, Year) {
+  std::istringstream input(
+      "1,person1,,3,1,t,10,,\n"
+      "2,person2,,2,29,t,10,,\n"
+      "3,person3,,3,1,t,11,Asia/Vladivostok,\n"
+      "4,person4,,3,1,f,12,,\n");
+  const auto report = Simulate(ReadSnapshot(input), MakeSettings(2023));
+
+  ASSERT_EQ(report.days.size(), 365);
+  int64_t users = 0;
+  for (const auto& day : report.days) {
+    users += day.users;
+  }
+  EXPECT_EQ(users, 2);
+  // Feb 29 is celebrated on Mar 1 in non-leap years
+  const auto& mar_1 = report.days[31 + 28];
+  EXPECT_EQ(mar_1.day, cctz::civil_day(2023, 3, 1));
+  EXPECT_EQ(mar_1.users, 2);
+  EXPECT_EQ(mar_1.birthdays, 3);
+
+  ASSERT_EQ(report.users_per_minute.size(), 2);
+  EXPECT_EQ(report.users_per_minute.at(userver::utils::datetime::Stringtime(
+                "2023-03-01T00:00:00+0000")),
+            1);
+  EXPECT_EQ(report.users_per_minute.at(userver::utils::datetime::Stringtime(
+                "2023-03-01T07:00:00+0000")),
+            1);
+}
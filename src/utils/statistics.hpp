@@ -0,0 +1,17 @@
+#pragma once
+
+#include <userver/utils/statistics/writer.hpp>
+
+namespace telegram_bot::utils {
+
+// p50, p95 and p99 over the recent period of RecentPeriod<Percentile<...>>
+template <typename Timings>
+void WritePercentiles(userver::utils::statistics::Writer&& writer,
+                      const Timings& timings) {
+  const auto stats = timings.GetStatsForPeriod();
+  writer["p50"] = stats.GetPercentile(50);
+  writer["p95"] = stats.GetPercentile(95);
+  writer["p99"] = stats.GetPercentile(99);
+}
+
+}  // namespace telegram_bot::utils
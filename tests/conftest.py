@@ -35,11 +35,19 @@ def userver_config_telegram_bot(mockserver_info):
         components['telegram-bot'][
             'telegram_host'
         ] = mockserver_info.base_url.strip('/')
+        # tests send a lot of messages to the same chat
+        components['telegram-bot']['chat_messages_burst'] = 1000
 
     return do_patch
     # /// [patch configs]
 
 
+@pytest.fixture(autouse=True)
+async def forget_seen_updates(service_client):
+    # the bot skips the updates it has seen, tests reuse update ids
+    await service_client.run_task('telegram-bot-forget-updates')
+
+
 @pytest.fixture(autouse=True)
 def delete_webhook_handler(mockserver):
     @mockserver.json_handler(f'/bot{TELEGRAM_TOKEN}/deleteWebhook')
@@ -25,8 +25,8 @@ def fetch_birthdays(pgsql):
             m,
             d,
             notification_enabled,
-            last_notification_time,
-            user_id
+            user_id,
+            next_occurrence
         FROM birthday.birthdays
         ORDER BY id
         """
@@ -38,8 +38,8 @@ def fetch_birthdays(pgsql):
             'month': row[2],
             'day': row[3],
             'is_enabled': row[4],
-            'last_notification_time': row[5],
-            'user_id': row[6],
+            'user_id': row[5],
+            'next_occurrence': row[6],
         }
         for row in cursor
     ]
@@ -67,8 +67,8 @@ def fetch_birthdays(pgsql):
                 'month': 2,
                 'day': 1,
                 'is_enabled': True,
-                'last_notification_time': None,
                 'user_id': 1000,
+                'next_occurrence': dt.date(2024, 2, 1),
             },
             id='ok',
         ),
@@ -82,8 +82,8 @@ def fetch_birthdays(pgsql):
                 'month': 2,
                 'day': 1,
                 'is_enabled': True,
-                'last_notification_time': None,
                 'user_id': 1002,
+                'next_occurrence': dt.date(2024, 2, 1),
             },
             id='without_year',
         ),
@@ -97,8 +97,8 @@ def fetch_birthdays(pgsql):
                 'month': 2,
                 'day': 1,
                 'is_enabled': True,
-                'last_notification_time': None,
                 'user_id': 1000,
+                'next_occurrence': dt.date(2024, 2, 1),
             },
             id='with_bot_tag',
         ),
@@ -147,8 +147,8 @@ def fetch_birthdays(pgsql):
                 'month': 2,
                 'day': 1,
                 'is_enabled': True,
-                'last_notification_time': None,
                 'user_id': 1000,
+                'next_occurrence': dt.date(2024, 2, 1),
             },
             id='cyrillic',
         ),
@@ -239,8 +239,8 @@ def fetch_birthdays(pgsql):
                 'month': 2,
                 'day': 29,
                 'is_enabled': True,
-                'last_notification_time': None,
                 'user_id': 1000,
+                'next_occurrence': dt.date(2024, 2, 29),
             },
             id='february_no_year',
         ),
@@ -254,8 +254,8 @@ def fetch_birthdays(pgsql):
                 'month': 2,
                 'day': 29,
                 'is_enabled': True,
-                'last_notification_time': None,
                 'user_id': 1000,
+                'next_occurrence': dt.date(2024, 2, 29),
             },
             id='february_leap_year',
         ),
@@ -326,10 +326,10 @@ async def test_add_birthday(
         }
 
     request = await handler_send_message.wait_call()
-    request_data = request['request'].form
-    request_text = request_data.pop('text').encode().decode('unicode-escape')
+    request_data = request['request'].json
+    request_text = request_data.pop('text')
     assert request_text == expected_message
-    assert request['request'].form == {
+    assert request['request'].json == {
         'chat_id': sender_chat_id,
     }
 
@@ -338,3 +338,82 @@ async def test_add_birthday(
         assert birthdays == [expected_birthday]
     else:
         assert not birthdays
+
+
+@pytest.mark.pgsql(
+    'pg_birthday',
+    queries=[
+        """
+        INSERT INTO birthday.users(id, chat_id)
+        VALUES (1000, 100500)
+        """,
+    ],
+)
+@pytest.mark.now(_NOW.isoformat())
+async def test_add_birthday_user_registered_again(
+    service_client, pgsql, mockserver
+):
+    # to update mocked time
+    await service_client.invalidate_caches()
+
+    messages = []
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/getUpdates')
+    def _handler_get_updates(request):
+        result = []
+        if messages:
+            result.append(
+                {
+                    'update_id': _handler_get_updates.times_called + 1,
+                    'message': {
+                        'message_id': 1,
+                        'date': 1,
+                        'chat': {
+                            'id': 100500,
+                            'type': 'private',
+                        },
+                        'text': messages.pop(0),
+                    }
+                }
+            )
+        return {
+            'ok': True,
+            'result': result,
+        }
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 1,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    # the user is cached
+    messages.append('/next_birthdays')
+    request = await handler_send_message.wait_call()
+    assert request['request'].json['text'] == 'There are no birthdays'
+
+    # another replica registers the chat again
+    cursor = pgsql['pg_birthday'].cursor()
+    cursor.execute('DELETE FROM birthday.users WHERE id = 1000')
+    cursor.execute(
+        'INSERT INTO birthday.users(id, chat_id) VALUES (1001, 100500)'
+    )
+
+    messages.append('/add_birthday 01.02 KINIAEV Foma')
+    request = await handler_send_message.wait_call()
+    assert request['request'].json['text'] == (
+        'Inserted the birthday of KINIAEV Foma on 01.02'
+    )
+    assert [
+        birthday['user_id'] for birthday in fetch_birthdays(pgsql)
+    ] == [1001]
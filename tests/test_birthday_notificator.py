@@ -19,9 +19,14 @@ def insert_birthday(
     day: int,
     is_enabled: bool,
     user_id: int,
-    last_notification_time: Optional[dt.datetime] = None,
+    notified_year: Optional[int] = None,
     year: Optional[int] = None,
+    today: dt.date = _NOW.date(),
 ):
+    # as the bot inserts birthdays and the notificator advances them
+    since = today - dt.timedelta(days=3)
+    if notified_year is not None:
+        since = max(since, dt.date(notified_year + 1, 1, 1))
     cursor = pgsql['pg_birthday'].cursor()
     cursor.execute(
         """
@@ -31,43 +36,72 @@ def insert_birthday(
             m,
             d,
             notification_enabled,
-            last_notification_time,
+            next_occurrence,
             user_id
         )
-        VALUES (%s, %s, %s, %s, %s, %s, %s)
+        VALUES (
+            %s, %s, %s, %s, %s,
+            birthday.first_occurrence_since(%s, %s, %s::DATE),
+            %s
+        )
+        RETURNING id
         """,
-        (person, year, month, day, is_enabled, last_notification_time, user_id)
+        (
+            person, year, month, day, is_enabled, month, day, since,
+            user_id,
+        )
     )
+    if notified_year is not None:
+        birthday_id = cursor.fetchone()[0]
+        cursor.execute(
+            """
+            INSERT INTO birthday.notifications_sent(birthday_id, year)
+            VALUES (%s, %s)
+            """,
+            (birthday_id, notified_year)
+        )
 
 
-def fetch_birthdays(pgsql):
+def fetch_notifications_sent(pgsql):
     cursor = pgsql['pg_birthday'].cursor()
     cursor.execute(
         """
         SELECT
-            person,
-            y,
-            m,
-            d,
-            notification_enabled,
-            last_notification_time,
-            user_id
+            birthdays.person,
+            notifications_sent.year
+        FROM birthday.notifications_sent
+        JOIN birthday.birthdays
+          ON birthdays.id = notifications_sent.birthday_id
+        ORDER BY birthdays.id, notifications_sent.year
+        """
+    )
+    return [(row[0], row[1]) for row in cursor]
+
+
+def fetch_next_occurrences(pgsql):
+    cursor = pgsql['pg_birthday'].cursor()
+    cursor.execute(
+        """
+        SELECT
+            birthdays.person,
+            birthdays.next_occurrence
         FROM birthday.birthdays
-        ORDER BY id
+        ORDER BY birthdays.id
         """
     )
-    return [
-        {
-            'person': row[0],
-            'year': row[1],
-            'month': row[2],
-            'day': row[3],
-            'is_enabled': row[4],
-            'last_notification_time': row[5],
-            'user_id': row[6],
-        }
-        for row in cursor
-    ]
+    return [(row[0], row[1]) for row in cursor]
+
+
+# the notificator scans the database or reads birthdays-cache
+@pytest.fixture(
+    name='notificator_task',
+    params=[
+        'distlock/birthday-notificator',
+        'birthday-notificator-calendar-cache',
+    ],
+)
+def _notificator_task(request):
+    return request.param
 
 
 @pytest.mark.pgsql(
@@ -80,7 +114,9 @@ def fetch_birthdays(pgsql):
     ],
 )
 @pytest.mark.now(_NOW.isoformat())
-async def test_notification(service_client, pgsql, testpoint, mockserver):
+async def test_notification(
+    service_client, pgsql, testpoint, mockserver, notificator_task
+):
     @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
     def handler_send_message(request):
         return {
@@ -104,7 +140,7 @@ async def test_notification(service_client, pgsql, testpoint, mockserver):
         day=15,
         is_enabled=True,
         user_id=1000,
-        last_notification_time=_NOW - dt.timedelta(days=365),
+        notified_year=2022,
         year=1960,
     )
     insert_birthday(
@@ -152,7 +188,10 @@ async def test_notification(service_client, pgsql, testpoint, mockserver):
     async def worker_finished(data):
         pass
 
-    await service_client.run_task('distlock/birthday-notificator')
+    # birthdays-cache sees the current state of the database
+    await service_client.invalidate_caches()
+    await service_client.run_task(notificator_task)
+    await service_client.run_task('notification-sender')
 
     assert worker_finished.has_calls
     request = worker_finished.next_call()['data']
@@ -171,7 +210,7 @@ async def test_notification(service_client, pgsql, testpoint, mockserver):
     requests = dict()
     for i in range(2):
         request = await handler_send_message.wait_call()
-        requests[request['request'].form['chat_id']] = request['request'].form
+        requests[request['request'].json['chat_id']] = request['request'].json
 
     assert requests == {
         100500: {
@@ -192,63 +231,173 @@ async def test_notification(service_client, pgsql, testpoint, mockserver):
         },
     }
 
-    assert fetch_birthdays(pgsql) == [
-        dict(
-            person='person1',
-            month=3,
-            day=15,
-            is_enabled=True,
-            last_notification_time=_NOW,
-            year=1960,
-            user_id=1000,
-        ),
-        dict(
-            person='person2',
-            month=3,
-            day=15,
-            is_enabled=True,
-            last_notification_time=_NOW,
-            year=None,
-            user_id=1000,
-        ),
-        dict(
-            person='person3',
-            month=3,
-            day=15,
-            is_enabled=False,
-            last_notification_time=None,
-            year=None,
-            user_id=1000,
-        ),
-        dict(
-            person='person4',
-            month=3,
-            day=14,
-            is_enabled=True,
-            last_notification_time=_NOW,
-            year=None,
-            user_id=1000,
-        ),
-        dict(
-            person='person5',
-            month=3,
-            day=15,
-            is_enabled=True,
-            last_notification_time=_NOW,
-            year=None,
-            user_id=1002,
-        ),
-        dict(
-            person='person6',
-            month=3,
-            day=14,
-            is_enabled=True,
-            last_notification_time=_NOW,
-            year=None,
-            user_id=1002,
-        ),
+    assert fetch_notifications_sent(pgsql) == [
+        ('person1', 2022),
+        ('person1', 2023),
+        ('person2', 2023),
+        ('person4', 2023),
+        ('person5', 2023),
+        ('person6', 2023),
+    ]
+    assert fetch_next_occurrences(pgsql) == [
+        ('person1', dt.date(2024, 3, 15)),
+        ('person2', dt.date(2024, 3, 15)),
+        ('person3', dt.date(2023, 3, 15)),
+        ('person4', dt.date(2024, 3, 14)),
+        ('person5', dt.date(2024, 3, 15)),
+        ('person6', dt.date(2024, 3, 14)),
     ]
 
-    await service_client.run_task('distlock/birthday-notificator')
+    # birthdays-cache sees the current state of the database
+    await service_client.invalidate_caches()
+    await service_client.run_task(notificator_task)
+    await service_client.run_task('notification-sender')
     assert worker_finished.has_calls
     assert not handler_send_message.has_calls
+
+
+@pytest.mark.pgsql(
+    'pg_birthday',
+    queries=[
+        """
+        INSERT INTO birthday.users(id, chat_id)
+        VALUES (1000, 100500)
+        """,
+    ],
+)
+@pytest.mark.now(
+    _TZ_MOSCOW.localize(dt.datetime(2023, 1, 2, 12)).isoformat()
+)
+async def test_notification_year_border(
+    service_client, pgsql, testpoint, mockserver, notificator_task
+):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 1,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    insert_birthday(
+        pgsql, person='person1', month=1, day=2, is_enabled=True, user_id=1000,
+        today=dt.date(2023, 1, 2),
+    )
+    insert_birthday(
+        pgsql, person='person2', month=12, day=31, is_enabled=True,
+        user_id=1000, today=dt.date(2023, 1, 2),
+    )
+    insert_birthday(
+        pgsql, person='person3', month=12, day=20, is_enabled=True,
+        user_id=1000, today=dt.date(2023, 1, 2),
+    )
+    insert_birthday(
+        pgsql, person='person4', month=1, day=3, is_enabled=True, user_id=1000,
+        today=dt.date(2023, 1, 2),
+    )
+
+    @testpoint('birthday-notificator')
+    async def worker_finished(data):
+        pass
+
+    # birthdays-cache sees the current state of the database
+    await service_client.invalidate_caches()
+    await service_client.run_task(notificator_task)
+    await service_client.run_task('notification-sender')
+
+    assert worker_finished.has_calls
+    assert worker_finished.next_call()['data'] == {
+        '1000': {
+            'forgotten': ['person2 on 31.12'],
+            'celebrate_today': ['person1'],
+        },
+    }
+    assert handler_send_message.times_called == 1
+
+
+@pytest.mark.pgsql(
+    'pg_birthday',
+    queries=[
+        """
+        INSERT INTO birthday.users(id, chat_id)
+        VALUES (1000, 100500), (1001, 100501)
+        """,
+        # the notification of user 1000 was planned earlier today and is not
+        # sent yet, the one of user 1001 is being sent
+        """
+        INSERT INTO birthday.notification_outbox(
+            user_id, local_day, text, attempts, next_attempt_at
+        )
+        VALUES
+            (1000, '2023-03-15', 'Today is birthday of person0', 0, NOW()),
+            (
+                1001, '2023-03-15', 'Today is birthday of person0', 1,
+                NOW() + INTERVAL '1 hour'
+            )
+        """,
+    ],
+)
+@pytest.mark.now(_NOW.isoformat())
+async def test_notification_pending(
+    service_client, pgsql, testpoint, mockserver, notificator_task
+):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 1,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    insert_birthday(
+        pgsql, person='person1', month=3, day=15, is_enabled=True,
+        user_id=1000,
+    )
+    insert_birthday(
+        pgsql, person='person2', month=3, day=15, is_enabled=True,
+        user_id=1001,
+    )
+
+    @testpoint('birthday-notificator')
+    async def worker_finished(data):
+        pass
+
+    # birthdays-cache sees the current state of the database
+    await service_client.invalidate_caches()
+    await service_client.run_task(notificator_task)
+    await service_client.run_task('notification-sender')
+
+    assert worker_finished.has_calls
+    assert handler_send_message.times_called == 1
+    request = await handler_send_message.wait_call()
+    assert request['request'].json == {
+        'chat_id': 100500,
+        'text': (
+            'Today is birthday of person0\n'
+            'Today is birthday of person1'
+        ),
+    }
+
+    # the occurrence of user 1001 is planned again once the notification
+    # being sent is gone
+    assert fetch_notifications_sent(pgsql) == [('person1', 2023)]
+    assert fetch_next_occurrences(pgsql) == [
+        ('person1', dt.date(2024, 3, 15)),
+        ('person2', dt.date(2023, 3, 15)),
+    ]
@@ -50,7 +50,7 @@ async def test_start(service_client, mockserver):
         }
 
     request = await handler_send_message.wait_call()
-    assert request['request'].form == {
+    assert request['request'].json == {
         'chat_id': 100500,
         'text': 'Hi!',
     }
@@ -95,7 +95,55 @@ async def test_chat_id(service_client, mockserver):
         }
 
     request = await handler_send_message.wait_call()
-    assert request['request'].form == {
+    assert request['request'].json == {
         'chat_id': 100500,
         'text': 'Your chat id is 100500',
     }
+
+
+@pytest.mark.now(_NOW.isoformat())
+async def test_repeated_update(service_client, mockserver):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/getUpdates')
+    def _handler_get_updates(request):
+        # the first update is returned again as if a poll response was lost
+        update_id = 1 if _handler_get_updates.times_called < 2 else 2
+        return {
+            'ok': True,
+            'result': [
+                {
+                    'update_id': update_id,
+                    'message': {
+                        'message_id': update_id,
+                        'date': 1,
+                        'chat': {
+                            'id': 100500,
+                            'type': 'private',
+                        },
+                        'text': '/start' if update_id == 1 else '/chat_id',
+                    }
+                }
+            ],
+        }
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 3,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    # updates of a chat are handled in order, so a repeated /start would
+    # come before /chat_id
+    request = await handler_send_message.wait_call()
+    assert request['request'].json['text'] == 'Hi!'
+    request = await handler_send_message.wait_call()
+    assert request['request'].json['text'] == 'Your chat id is 100500'
@@ -1,5 +1,4 @@
 import base64
-import json
 import datetime as dt
 from typing import Any
 from typing import Dict
@@ -33,9 +32,13 @@ def insert_birthday(
     is_enabled: bool,
     id: int,
     user_id: int,
-    last_notification_time: Optional[dt.datetime] = None,
-    year: Optional[int] = None
+    year: Optional[int] = None,
+    notified_year: Optional[int] = None,
 ):
+    # as the bot inserts birthdays and the notificator advances them
+    since = _NOW.date() - dt.timedelta(days=3)
+    if notified_year is not None:
+        since = max(since, dt.date(notified_year + 1, 1, 1))
     cursor = pgsql['pg_birthday'].cursor()
     cursor.execute(
         """
@@ -45,11 +48,15 @@ def insert_birthday(
             m,
             d,
             notification_enabled,
-            last_notification_time,
+            next_occurrence,
             id,
             user_id
         )
-        VALUES (%s, %s, %s, %s, %s, %s, %s, %s)
+        VALUES (
+            %s, %s, %s, %s, %s,
+            birthday.first_occurrence_since(%s, %s, %s::DATE),
+            %s, %s
+        )
         """,
         (
             person,
@@ -57,11 +64,21 @@ def insert_birthday(
             month,
             day,
             is_enabled,
-            last_notification_time,
+            month,
+            day,
+            since,
             id,
             user_id
         )
     )
+    if notified_year is not None:
+        cursor.execute(
+            """
+            INSERT INTO birthday.notifications_sent(birthday_id, year)
+            VALUES (%s, %s)
+            """,
+            (id, notified_year)
+        )
 
 
 def fetch_birthdays(pgsql):
@@ -74,7 +91,6 @@ def fetch_birthdays(pgsql):
             m,
             d,
             notification_enabled,
-            last_notification_time,
             id,
             user_id
         FROM birthday.birthdays
@@ -88,9 +104,8 @@ def fetch_birthdays(pgsql):
             'month': row[2],
             'day': row[3],
             'is_enabled': row[4],
-            'last_notification_time': row[5],
-            'id': row[6],
-            'user_id': row[7],
+            'id': row[5],
+            'user_id': row[6],
         }
         for row in cursor
     ]
@@ -189,7 +204,11 @@ class Button:
             [
                 dict(month=1, day=15, id=1000, user_id=1000),
                 dict(month=1, day=17, id=1001, user_id=1000),
-                dict(month=3, day=15, id=1002, user_id=1000),
+                # notified today, its next occurrence is in 2024
+                dict(
+                    month=3, day=15, id=1002, user_id=1000,
+                    notified_year=2023,
+                ),
                 dict(month=4, day=17, id=1003, user_id=1000),
                 dict(month=12, day=20, id=1004, user_id=1000),
                 dict(month=3, day=15, id=1005, user_id=1002),
@@ -326,8 +345,8 @@ async def test_next_birthdays(
             is_enabled=True,
             id=event['id'],
             user_id=event['user_id'],
-            last_notification_time=_NOW,
             year=None,
+            notified_year=event.get('notified_year'),
         )
 
     # to update mocked time
@@ -376,7 +395,6 @@ async def test_next_birthdays(
                     {
                         'text': button.title,
                         'callback_data': button.data,
-                        'pay': False,
                     }
                 ]
                 for button in expected_buttons
@@ -386,11 +404,10 @@ async def test_next_birthdays(
         expected_reply_markup = None
 
     request = await handler_send_message.wait_call()
-    request_data = request['request'].form
+    request_data = request['request'].json
 
     if expected_reply_markup is not None:
         reply_markup = request_data.pop('reply_markup')
-        reply_markup = json.loads(reply_markup)
         assert reply_markup == expected_reply_markup
     else:
         assert 'reply_markup' not in request_data
@@ -565,7 +582,6 @@ async def test_edit_birthday(
                     {
                         'text': button.title,
                         'callback_data': button.data,
-                        'pay': False,
                     }
                 ]
                 for button in expected_buttons
@@ -578,11 +594,10 @@ async def test_edit_birthday(
 
     if expected_message:
         request = await handler_edit_message.wait_call()
-        request_data = request['request'].form
+        request_data = request['request'].json
 
         if expected_reply_markup is not None:
             reply_markup = request_data.pop('reply_markup')
-            reply_markup = json.loads(reply_markup)
             assert reply_markup == expected_reply_markup
         else:
             assert 'reply_markup' not in request_data
@@ -711,7 +726,6 @@ async def test_delete_birthday(
             'month': event['month'],
             'day': event['day'],
             'is_enabled': True,
-            'last_notification_time': _NOW,
             'id': event['id'],
             'user_id': event['user_id'],
         }
@@ -727,7 +741,6 @@ async def test_delete_birthday(
             is_enabled=row['is_enabled'],
             id=row['id'],
             user_id=row['user_id'],
-            last_notification_time=row['last_notification_time'],
             year=row['year'],
         )
 
@@ -804,7 +817,7 @@ async def test_delete_birthday(
 
     if expected_message:
         request = await handler_edit_message.wait_call()
-        request_data = request['request'].form
+        request_data = request['request'].json
         assert 'reply_markup' not in request_data
 
         assert request_data == {
@@ -968,7 +981,7 @@ async def test_cancel(
 
     if expected_message:
         request = await handler_edit_message.wait_call()
-        request_data = request['request'].form
+        request_data = request['request'].json
         assert 'reply_markup' not in request_data
 
         assert request_data == {
@@ -978,3 +991,86 @@ async def test_cancel(
         }
     else:
         assert not handler_edit_message.has_calls
+
+
+@pytest.mark.pgsql(
+    'pg_birthday',
+    queries=[
+        """
+        INSERT INTO birthday.users(id, chat_id)
+        VALUES (1000, 100500)
+        """,
+    ],
+)
+@pytest.mark.now(_NOW.isoformat())
+async def test_next_birthdays_after_add(service_client, pgsql, mockserver):
+    # to update mocked time, birthdays-cache is not updated after the add
+    await service_client.invalidate_caches()
+
+    messages = []
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/getUpdates')
+    def _handler_get_updates(request):
+        result = []
+        if messages:
+            result.append(
+                {
+                    'update_id': _handler_get_updates.times_called + 1,
+                    'message': {
+                        'message_id': 1,
+                        'date': 1,
+                        'chat': {
+                            'id': 100500,
+                            'type': 'private',
+                        },
+                        'text': messages.pop(0),
+                    }
+                }
+            )
+        return {
+            'ok': True,
+            'result': result,
+        }
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 1,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    messages.append('/add_birthday 20.03 KINIAEV Foma')
+    request = await handler_send_message.wait_call()
+    assert request['request'].json['text'] == (
+        'Inserted the birthday of KINIAEV Foma on 20.03'
+    )
+
+    cursor = pgsql['pg_birthday'].cursor()
+    cursor.execute('SELECT id FROM birthday.birthdays')
+    birthday_id = cursor.fetchone()[0]
+
+    # the birthday is listed at once
+    messages.append('/next_birthdays')
+    request = await handler_send_message.wait_call()
+    request_data = request['request'].json
+    assert request_data['text'] == 'Next 1 birthdays:'
+    button = Button(
+        title='KINIAEV Foma on 20.03',
+        birthday_id=birthday_id,
+        context_id=_CONTEXT_ID_NEXT_BDS,
+        button_id=_BUTTON_ID_EDIT_BD,
+    )
+    assert request_data['reply_markup'] == {
+        'inline_keyboard': [
+            [{'text': button.title, 'callback_data': button.data}],
+        ],
+    }
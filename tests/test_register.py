@@ -132,10 +132,10 @@ async def test_register(
         }
 
     request = await handler_send_message.wait_call()
-    request_data = request['request'].form
-    request_text = request_data.pop('text').encode().decode('unicode-escape')
+    request_data = request['request'].json
+    request_text = request_data.pop('text')
     assert request_text == expected_message
-    assert request['request'].form == {
+    assert request['request'].json == {
         'chat_id': sender_chat_id,
     }
 
@@ -0,0 +1,168 @@
+import datetime as dt
+from typing import Any
+from typing import Dict
+from typing import List
+
+import pytest
+import pytz
+
+from testsuite.databases import pgsql
+
+_TZ_MOSCOW = pytz.timezone('Europe/Moscow')
+_NOW = _TZ_MOSCOW.localize(dt.datetime(2023, 3, 15, 12))
+
+_TELEGRAM_TOKEN = 'fake_token'
+
+
+def fetch_users(pgsql):
+    cursor = pgsql['pg_birthday'].cursor()
+    cursor.execute(
+        """
+        SELECT
+            id,
+            timezone,
+            to_char(notification_time, 'HH24:MI'),
+            notification_bucket
+        FROM birthday.users
+        ORDER BY id
+        """
+    )
+    return [
+        {
+            'id': row[0],
+            'timezone': row[1],
+            'notification_time': row[2],
+            'notification_bucket': row[3],
+        }
+        for row in cursor
+    ]
+
+
+@pytest.mark.pgsql(
+    'pg_birthday',
+    queries=[
+        """
+        INSERT INTO birthday.users(id, chat_id)
+        VALUES (1000, 100500)
+        """,
+    ],
+)
+@pytest.mark.parametrize(
+    'text, expected_message, expected_users',
+    [
+        pytest.param(
+            '/timezone Asia/Yekaterinburg',
+            'Timezone is set to Asia/Yekaterinburg',
+            [
+                {
+                    'id': 1000,
+                    'timezone': 'Asia/Yekaterinburg',
+                    'notification_time': None,
+                    'notification_bucket': 'Asia/Yekaterinburg|',
+                },
+            ],
+            id='timezone',
+        ),
+        pytest.param(
+            '/timezone Mars/Olympus',
+            'Unknown timezone',
+            [
+                {
+                    'id': 1000,
+                    'timezone': None,
+                    'notification_time': None,
+                    'notification_bucket': '|',
+                },
+            ],
+            id='unknown_timezone',
+        ),
+        pytest.param(
+            '/notification_time 09:30',
+            'Notification time is set to 09:30',
+            [
+                {
+                    'id': 1000,
+                    'timezone': None,
+                    'notification_time': '09:30',
+                    'notification_bucket': '|09:30',
+                },
+            ],
+            id='notification_time',
+        ),
+        pytest.param(
+            '/notification_time 25:00',
+            'Invalid time',
+            [
+                {
+                    'id': 1000,
+                    'timezone': None,
+                    'notification_time': None,
+                    'notification_bucket': '|',
+                },
+            ],
+            id='invalid_notification_time',
+        ),
+    ]
+)
+@pytest.mark.now(_NOW.isoformat())
+async def test_settings(
+    service_client,
+    pgsql,
+    mockserver,
+    text: str,
+    expected_message: str,
+    expected_users: List[Dict[str, Any]],
+):
+    # to update mocked time
+    await service_client.invalidate_caches()
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/getUpdates')
+    def _handler_get_updates(request):
+        # return new updates only once
+        if _handler_get_updates.times_called < 2:
+            return {
+                'ok': True,
+                'result': [
+                    {
+                        'update_id': 1,
+                        'message': {
+                            'message_id': 1,
+                            'date': 1,
+                            'chat': {
+                                'id': 100500,
+                                'type': 'private',
+                            },
+                            'text': text,
+                        }
+                    }
+                ],
+            }
+        else:
+            return {
+                'ok': True,
+                'result': [],
+            }
+
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 1,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    request = await handler_send_message.wait_call()
+    request_data = request['request'].json
+    request_text = request_data.pop('text')
+    assert request_text == expected_message
+
+    users = fetch_users(pgsql)
+    assert users == expected_users
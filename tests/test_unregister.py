@@ -45,7 +45,6 @@ def fetch_birthdays(pgsql):
             m,
             d,
             notification_enabled,
-            last_notification_time,
             user_id
         FROM birthday.birthdays
         ORDER BY id
@@ -58,8 +57,7 @@ def fetch_birthdays(pgsql):
             'month': row[2],
             'day': row[3],
             'is_enabled': row[4],
-            'last_notification_time': row[5],
-            'user_id': row[6],
+            'user_id': row[5],
         }
         for row in cursor
     ]
@@ -79,11 +77,12 @@ def fetch_birthdays(pgsql):
             m,
             d,
             notification_enabled,
+            next_occurrence,
             user_id
         )
-        VALUES ('name', 2000, 1, 1, true, 1000),
-               ('name', 2000, 1, 2, true, 1000),
-               ('name', 2000, 1, 2, true, 1001)
+        VALUES ('name', 2000, 1, 1, true, '2024-01-01', 1000),
+               ('name', 2000, 1, 2, true, '2024-01-02', 1000),
+               ('name', 2000, 1, 2, true, '2024-01-02', 1001)
         """
     ],
 )
@@ -160,10 +159,10 @@ async def test_unregister(
         }
 
     request = await handler_send_message.wait_call()
-    request_data = request['request'].form
-    request_text = request_data.pop('text').encode().decode('unicode-escape')
+    request_data = request['request'].json
+    request_text = request_data.pop('text')
     assert request_text == expected_message
-    assert request['request'].form == {
+    assert request['request'].json == {
         'chat_id': sender_chat_id,
     }
 
@@ -0,0 +1,115 @@
+import pytest
+
+_TELEGRAM_TOKEN = 'fake_token'
+_WEBHOOK_SECRET = 'fake_secret'
+
+_UPDATE = {
+    'update_id': 1,
+    'message': {
+        'message_id': 1,
+        'date': 1,
+        'chat': {
+            'id': 100500,
+            'type': 'private',
+        },
+        'text': '/chat_id',
+    },
+}
+
+
+async def test_webhook_update(service_client, mockserver):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 2,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    response = await service_client.post(
+        '/telegram/webhook',
+        json=_UPDATE,
+        headers={'X-Telegram-Bot-Api-Secret-Token': _WEBHOOK_SECRET},
+    )
+    assert response.status == 200
+
+    request = await handler_send_message.wait_call()
+    assert request['request'].json == {
+        'chat_id': 100500,
+        'text': 'Your chat id is 100500',
+    }
+
+
+@pytest.mark.parametrize(
+    'headers',
+    [
+        pytest.param({}, id='no_secret'),
+        pytest.param(
+            {'X-Telegram-Bot-Api-Secret-Token': 'wrong_secret'},
+            id='wrong_secret',
+        ),
+    ],
+)
+async def test_webhook_unauthorized(service_client, mockserver, headers):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {'ok': True, 'result': {}}
+
+    response = await service_client.post(
+        '/telegram/webhook', json=_UPDATE, headers=headers
+    )
+    assert response.status == 401
+    assert not handler_send_message.has_calls
+
+
+async def test_webhook_duplicate_update(service_client, mockserver):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {
+            'ok': True,
+            'description': 'foo',
+            'result': {
+                'message_id': 2,
+                'date': 1,
+                'chat': {
+                    'id': 100500,
+                    'type': 'private',
+                },
+                'text': 'Text',
+            },
+        }
+
+    # telegram delivers the update again as the first response is lost
+    for _ in range(2):
+        response = await service_client.post(
+            '/telegram/webhook',
+            json=_UPDATE,
+            headers={'X-Telegram-Bot-Api-Secret-Token': _WEBHOOK_SECRET},
+        )
+        assert response.status == 200
+
+    await handler_send_message.wait_call()
+    assert not handler_send_message.has_calls
+
+
+async def test_webhook_malformed_update(service_client, mockserver):
+    @mockserver.json_handler(f'/bot{_TELEGRAM_TOKEN}/sendMessage')
+    def handler_send_message(request):
+        return {'ok': True, 'result': {}}
+
+    # accepted, so telegram does not send it again
+    response = await service_client.post(
+        '/telegram/webhook',
+        data='{not json',
+        headers={'X-Telegram-Bot-Api-Secret-Token': _WEBHOOK_SECRET},
+    )
+    assert response.status == 200
+    assert not handler_send_message.has_calls